@@ -12,12 +12,9 @@
 
 static int warp7_devices_init(void)
 {
-	if (!of_machine_is_compatible("warp,imx7s-warp"))
-		return 0;
-
 	imx6_bbu_internal_mmc_register_handler("mmc", "/dev/mmc2.boot0.barebox",
 					       BBU_HANDLER_FLAG_DEFAULT);
 
 	return 0;
 }
-device_initcall(warp7_devices_init);
+device_machine_initcall(warp7_devices_init, "warp,imx7s-warp");
@@ -35,9 +35,6 @@ static void mx7_sabresd_init_fec1(void)
 
 static int mx7_sabresd_coredevices_init(void)
 {
-	if (!of_machine_is_compatible("fsl,imx7d-sdb"))
-		return 0;
-
 	mx7_sabresd_init_fec1();
 
 	phy_register_fixup_for_uid(PHY_ID_BCM54220, 0xffffffff,
@@ -45,4 +42,4 @@ static int mx7_sabresd_coredevices_init(void)
 
 	return 0;
 }
-coredevice_initcall(mx7_sabresd_coredevices_init);
+coredevice_machine_initcall(mx7_sabresd_coredevices_init, "fsl,imx7d-sdb");
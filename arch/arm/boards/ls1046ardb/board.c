@@ -185,9 +185,6 @@ static int rdb_nand_init(void)
 
 static int rdb_postcore_init(void)
 {
-	if (!of_machine_is_compatible("fsl,ls1046a-rdb"))
-		return 0;
-
 	defaultenv_append_directory(defaultenv_ls1046ardb);
 
 	ls1046a_bbu_mmc_register_handler("sd", "/dev/mmc0.barebox",
@@ -196,4 +193,4 @@ static int rdb_postcore_init(void)
 	return rdb_nand_init();
 }
 
-postcore_initcall(rdb_postcore_init);
+postcore_machine_initcall(rdb_postcore_init, "fsl,ls1046a-rdb");
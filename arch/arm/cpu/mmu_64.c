@@ -21,6 +21,9 @@
 #include <asm/system_info.h>
 #include <linux/pagemap.h>
 #include <tee/optee.h>
+#include <pbl.h>
+#include <asm/mmuinfo.h>
+#include <smp_pool.h>
 
 #include "mmu_64.h"
 
@@ -51,17 +54,132 @@ static uint64_t *alloc_pte(void)
 
 	return (void *)get_ttb() + idx * GRANULE_SIZE;
 }
+
+static void free_pte(uint64_t *table)
+{
+}
+
+#define mmu_stat_inc(member)		do { } while (0)
+#define mmu_stat_add(member, val)	do { } while (0)
 #else
+static struct {
+	unsigned long remaps;
+	unsigned long splits;
+	unsigned long merges;
+	unsigned long tlb_flushes;
+	unsigned long tables_reused;
+	u64 flushed_bytes;
+} mmu_stats;
+
+#define mmu_stat_inc(member)		(mmu_stats.member++)
+#define mmu_stat_add(member, val)	(mmu_stats.member += (val))
+
+/*
+ * Tables that are no longer referenced go to the pending list first. The
+ * TLB may still hold walk entries pointing into them, so they are only
+ * reused once the TLB has been invalidated. Tables are never handed back
+ * to malloc, as the early ones live in the ttb area.
+ */
+static uint64_t *pte_free_list, *pte_pending_list;
+
 static uint64_t *alloc_pte(void)
 {
-	uint64_t *new_table = xmemalign(GRANULE_SIZE, GRANULE_SIZE);
+	uint64_t *new_table;
+
+	if (pte_free_list) {
+		new_table = pte_free_list;
+		pte_free_list = (uint64_t *)new_table[0];
+		mmu_stat_inc(tables_reused);
+	} else {
+		new_table = xmemalign(GRANULE_SIZE, GRANULE_SIZE);
+	}
 
 	/* Mark all entries as invalid */
 	memset(new_table, 0, GRANULE_SIZE);
 
 	return new_table;
 }
+
+static void free_pte(uint64_t *table)
+{
+	table[0] = (uint64_t)pte_pending_list;
+	pte_pending_list = table;
+}
+#endif
+
+static void release_pending_ptes(void)
+{
+#ifndef __PBL__
+	uint64_t *table;
+
+	while ((table = pte_pending_list)) {
+		pte_pending_list = (uint64_t *)table[0];
+		table[0] = (uint64_t)pte_free_list;
+		pte_free_list = table;
+	}
 #endif
+}
+
+/*
+ * Remaps done between mmu_batch_begin() and mmu_batch_end() share a
+ * single TLB invalidation at the end of the batch.
+ */
+static unsigned int tlb_batch_depth;
+static bool tlb_batch_pending;
+
+static void __mmu_tlb_invalidate(void)
+{
+	/*
+	 * Pool secondaries walk the same tables, so they must drop their
+	 * walk cache entries as well before tables are reused.
+	 */
+	if (!IN_PBL && smp_pool_online())
+		tlb_invalidate_is();
+	else
+		tlb_invalidate();
+	mmu_stat_inc(tlb_flushes);
+}
+
+static void mmu_tlb_invalidate(void)
+{
+	if (tlb_batch_depth) {
+		tlb_batch_pending = true;
+		return;
+	}
+
+	__mmu_tlb_invalidate();
+	release_pending_ptes();
+}
+
+/*
+ * Replace the live table entry @pte with the block entry @block. This
+ * changes the block size of a mapping, so it follows break-before-make:
+ * no CPU may hold TLB or walk cache entries of the old table once the
+ * block is visible. The caller frees the old table afterwards.
+ */
+static void replace_table(uint64_t *pte, uint64_t block)
+{
+	*pte = PTE_TYPE_FAULT;
+	__mmu_tlb_invalidate();
+
+	*pte = block;
+	dsb();
+	isb();
+}
+
+static __maybe_unused void mmu_batch_begin(void)
+{
+	tlb_batch_depth++;
+}
+
+static __maybe_unused void mmu_batch_end(void)
+{
+	if (--tlb_batch_depth || !tlb_batch_pending)
+		return;
+
+	tlb_batch_pending = false;
+	mmu_tlb_invalidate();
+}
 
 static uint64_t *__find_pte(uint64_t *ttb, uint64_t addr, int *level)
 {
@@ -94,6 +212,21 @@ static __maybe_unused uint64_t *find_pte(uint64_t addr)
 
 #define MAX_PTE_ENTRIES 512
 
+static size_t granule_size(int level)
+{
+	switch (level) {
+	default:
+	case 0:
+		return L0_XLAT_SIZE;
+	case 1:
+		return L1_XLAT_SIZE;
+	case 2:
+		return L2_XLAT_SIZE;
+	case 3:
+		return L3_XLAT_SIZE;
+	}
+}
+
 /* Splits a block PTE into table with subpages spanning the old block */
 static void split_block(uint64_t *pte, int level)
 {
@@ -123,6 +256,99 @@ static void split_block(uint64_t *pte, int level)
 
 	/* Set the new table into effect */
 	set_table(pte, new_table);
+	mmu_stat_inc(splits);
+}
+
+/* Release the table @pte points to and all tables below it */
+static void free_level_table(uint64_t *pte, int level)
+{
+	uint64_t *table;
+	int i;
+
+	if (level >= 3 || pte_type(pte) != PTE_TYPE_TABLE)
+		return;
+
+	table = get_level_table(pte);
+
+	for (i = 0; i < MAX_PTE_ENTRIES; i++)
+		free_level_table(&table[i], level + 1);
+
+	free_pte(table);
+}
+
+/*
+ * Replace the table @pte at @level points to with a single block entry,
+ * if all entries of the table map one contiguous, suitably aligned range
+ * with the same attributes. This undoes split_block() once a remap has
+ * made a block uniform again.
+ */
+static bool merge_table(uint64_t *pte, int level)
+{
+	uint64_t child_shift = level2shift(level + 1);
+	uint64_t *table, first;
+	int i;
+
+	/* there are no level 0 blocks with a 4K granule */
+	if (level < 1 || level > 2 || pte_type(pte) != PTE_TYPE_TABLE)
+		return false;
+
+	table = get_level_table(pte);
+	first = table[0];
+
+	/* Level 3 pages have the table type */
+	if ((first & PTE_TYPE_MASK) != (level == 2 ? PTE_TYPE_PAGE : PTE_TYPE_BLOCK))
+		return false;
+
+	if (!IS_ALIGNED(first & XLAT_ADDR_MASK, granule_size(level)))
+		return false;
+
+	for (i = 1; i < MAX_PTE_ENTRIES; i++)
+		if (table[i] != first + ((uint64_t)i << child_shift))
+			return false;
+
+	replace_table(pte, (first & ~(uint64_t)PTE_TYPE_MASK) | PTE_TYPE_BLOCK);
+	free_pte(table);
+	mmu_stat_inc(merges);
+
+	return true;
+}
+
+static uint64_t *find_level_pte(uint64_t *ttb, uint64_t addr, int level)
+{
+	uint64_t *pte = ttb;
+	int i;
+
+	for (i = 0; ; i++) {
+		pte += (addr & level2mask(i)) >> level2shift(i);
+		if (i == level)
+			return pte;
+
+		if (pte_type(pte) != PTE_TYPE_TABLE)
+			return NULL;
+
+		pte = get_level_table(pte);
+	}
+}
+
+/*
+ * Merge tables around a remapped range back into 2M and 1G blocks where
+ * possible, going bottom up so 4K pages can become 1G blocks in one go.
+ */
+static void merge_range(uint64_t *ttb, uint64_t virt, uint64_t size)
+{
+	uint64_t addr, end = virt + size;
+	int level;
+
+	for (level = 2; level >= 1; level--) {
+		size_t block_size = granule_size(level);
+
+		for (addr = ALIGN_DOWN(virt, block_size); addr < end; addr += block_size) {
+			uint64_t *pte = find_level_pte(ttb, addr, level);
+
+			if (pte)
+				merge_table(pte, level);
+		}
+	}
 }
 
 static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
@@ -135,7 +361,8 @@ static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
 	uint64_t idx;
 	uint64_t addr;
 	uint64_t *table;
-	uint64_t type;
+	uint64_t type, old;
+	uint64_t remap_size;
 	int level;
 
 	addr = virt;
@@ -143,6 +370,7 @@ static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
 	attr &= ~PTE_TYPE_MASK;
 
 	size = PAGE_ALIGN(size);
+	remap_size = size;
 
 	while (size) {
 		table = ttb;
@@ -157,7 +385,14 @@ static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
 			    IS_ALIGNED(phys, block_size)) {
 				type = (level == 3) ?
 					PTE_TYPE_PAGE : PTE_TYPE_BLOCK;
-				*pte = phys | attr | type;
+				old = *pte;
+				if (level < 3 && pte_type(&old) == PTE_TYPE_TABLE) {
+					/* the block replaces a table split earlier */
+					replace_table(pte, phys | attr | type);
+					free_level_table(&old, level);
+				} else {
+					*pte = phys | attr | type;
+				}
 				addr += block_size;
 				phys += block_size;
 				size -= block_size;
@@ -171,22 +406,10 @@ static void create_sections(uint64_t virt, uint64_t phys, uint64_t size,
 
 	}
 
-	tlb_invalidate();
-}
+	if (!IN_PBL)
+		merge_range(ttb, virt, remap_size);
 
-static size_t granule_size(int level)
-{
-	switch (level) {
-	default:
-	case 0:
-		return L0_XLAT_SIZE;
-	case 1:
-		return L1_XLAT_SIZE;
-	case 2:
-		return L2_XLAT_SIZE;
-	case 3:
-		return L3_XLAT_SIZE;
-	}
+	mmu_tlb_invalidate();
 }
 
 static bool pte_is_cacheable(uint64_t pte)
@@ -246,8 +469,10 @@ static void flush_cacheable_pages(void *start, size_t size)
 		 * We don't have a previous contiguous flush area to append to.
 		 * If we recorded any area before, let's flush it now
 		 */
-		if (flush_start != ~0ULL)
+		if (flush_start != ~0ULL) {
 			v8_flush_dcache_range(flush_start, flush_end);
+			mmu_stat_add(flushed_bytes, flush_end - flush_start);
+		}
 
 		/* and start the new contiguous flush area with this page */
 		flush_start = addr;
@@ -255,8 +480,10 @@ static void flush_cacheable_pages(void *start, size_t size)
 	}
 
 	/* The previous loop won't flush the last cached range, so do it here */
-	if (flush_start != ~0ULL)
+	if (flush_start != ~0ULL) {
 		v8_flush_dcache_range(flush_start, flush_end);
+		mmu_stat_add(flushed_bytes, flush_end - flush_start);
+	}
 }
 
 static unsigned long get_pte_attrs(unsigned flags)
@@ -296,6 +523,7 @@ int arch_remap_range(void *virt_addr, phys_addr_t phys_addr, size_t size, unsign
 		flush_cacheable_pages(virt_addr, size);
 
 	create_sections((uint64_t)virt_addr, phys_addr, (uint64_t)size, attrs);
+	mmu_stat_inc(remaps);
 
 	return 0;
 }
@@ -339,6 +567,8 @@ void __mmu_init(bool mmu_on)
 		 */
 		pr_crit("Can't request SDRAM region for ttb at %p\n", ttb);
 
+	mmu_batch_begin();
+
 	for_each_memory_bank(bank) {
 		struct resource *rsv;
 		resource_size_t pos;
@@ -354,6 +584,8 @@ void __mmu_init(bool mmu_on)
 		remap_range((void *)pos, bank->start + bank->size - pos, MAP_CACHED);
 	}
 
+	mmu_batch_end();
+
 	/* Make zero page faulting to catch NULL pointer derefs */
 	zero_page_faulting();
 	create_guard_page();
@@ -458,3 +690,67 @@ void mmu_early_disable(void)
 	dsb();
 	isb();
 }
+
+#ifndef __PBL__
+struct mmu_walk_stats {
+	unsigned long tables[4];
+	unsigned long blocks[4];
+};
+
+static void mmu_walk(uint64_t *table, int level, struct mmu_walk_stats *ws)
+{
+	int i;
+
+	ws->tables[level]++;
+
+	for (i = 0; i < MAX_PTE_ENTRIES; i++) {
+		uint64_t *pte = &table[i];
+
+		if (pte_type(pte) == PTE_TYPE_FAULT)
+			continue;
+
+		if (level < 3 && pte_type(pte) == PTE_TYPE_TABLE)
+			mmu_walk(get_level_table(pte), level + 1, ws);
+		else
+			ws->blocks[level]++;
+	}
+}
+
+/**
+ * mmuinfo_v8_stats - print page table usage and remap statistics
+ */
+int mmuinfo_v8_stats(void)
+{
+	static const char * const block_names[] = { "512G", "1G", "2M", "4K" };
+	struct mmu_walk_stats ws = {};
+	unsigned long tables = 0, free_tables = 0;
+	uint64_t *table;
+	int level;
+
+	mmu_walk(get_ttb(), 0, &ws);
+
+	for (level = 0; level < 4; level++)
+		tables += ws.tables[level];
+
+	for (table = pte_free_list; table; table = (uint64_t *)table[0])
+		free_tables++;
+	for (table = pte_pending_list; table; table = (uint64_t *)table[0])
+		free_tables++;
+
+	printf("page tables: %lu in use (%lu KiB), %lu free\n",
+	       tables, tables * GRANULE_SIZE / SZ_1K, free_tables);
+
+	printf("mappings:");
+	for (level = 0; level < 4; level++)
+		printf(" %lu x %s", ws.blocks[level], block_names[level]);
+	printf("\n");
+
+	printf("remaps: %lu, block splits: %lu, block merges: %lu, tables reused: %lu\n",
+	       mmu_stats.remaps, mmu_stats.splits, mmu_stats.merges,
+	       mmu_stats.tables_reused);
+	printf("TLB invalidations: %lu, cache flushed on remap: %llu KiB\n",
+	       mmu_stats.tlb_flushes, mmu_stats.flushed_bytes / SZ_1K);
+
+	return 0;
+}
+#endif
@@ -43,6 +43,27 @@ static inline void tlb_invalidate(void)
 	isb();
 }
 
+/*
+ * Same as tlb_invalidate(), but broadcast to all CPUs in the inner
+ * shareable domain, for when secondaries run on our page tables
+ */
+static inline void tlb_invalidate_is(void)
+{
+	unsigned int el = current_el();
+
+	__asm__ __volatile__("dsb ish\n\t" : : : "memory");
+
+	if (el == 1)
+		__asm__ __volatile__("tlbi vmalle1is\n\t" : : : "memory");
+	else if (el == 2)
+		__asm__ __volatile__("tlbi alle2is\n\t" : : : "memory");
+	else if (el == 3)
+		__asm__ __volatile__("tlbi alle3is\n\t" : : : "memory");
+
+	__asm__ __volatile__("dsb ish\n\t" : : : "memory");
+	isb();
+}
+
 static inline void set_ttbr_tcr_mair(int el, uint64_t table, uint64_t tcr, uint64_t attr)
 {
 	dsb();
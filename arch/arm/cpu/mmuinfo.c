@@ -22,14 +22,26 @@ int mmuinfo(void *addr)
 	return -ENOSYS;
 }
 
+static int mmuinfo_stats(void)
+{
+	if (IS_ENABLED(CONFIG_CPU_V8) && IS_ENABLED(CONFIG_MMU))
+		return mmuinfo_v8_stats();
+
+	return -ENOSYS;
+}
+
 static __maybe_unused int do_mmuinfo(int argc, char *argv[])
 {
 	unsigned long addr;
 	int access_zero_page = -1;
 	int opt;
 
-	while ((opt = getopt(argc, argv, "zZ")) > 0) {
+	while ((opt = getopt(argc, argv, "zZs")) > 0) {
 		switch (opt) {
+		case 's':
+			if (argc - optind != 0)
+				return COMMAND_ERROR_USAGE;
+			return mmuinfo_stats();
 		case 'z':
 			access_zero_page = true;
 			break;
@@ -72,13 +84,14 @@ BAREBOX_CMD_HELP_TEXT("")
 BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-z",  "enable access to zero page")
 BAREBOX_CMD_HELP_OPT ("-Z",  "disable access to zero page")
+BAREBOX_CMD_HELP_OPT ("-s",  "show page table usage and remap statistics")
 BAREBOX_CMD_HELP_END
 
 #ifdef CONFIG_COMMAND_SUPPORT
 BAREBOX_CMD_START(mmuinfo)
 	.cmd            = do_mmuinfo,
 	BAREBOX_CMD_DESC("show MMU/cache information of an address")
-	BAREBOX_CMD_OPTS("[-zZ | ADDRESS]")
+	BAREBOX_CMD_OPTS("[-zZ | -s | ADDRESS]")
 	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
 	BAREBOX_CMD_HELP(cmd_mmuinfo_help)
 BAREBOX_CMD_END
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * smp_64.c - PSCI backend for the secondary CPU worker pool
+ *
+ * Secondaries are started with PSCI CPU_ON into the same exception level
+ * and the same translation tables as the boot CPU, run the pool loop on
+ * their own stack and power themselves down with PSCI CPU_OFF when the
+ * pool is parked.
+ */
+#define pr_fmt(fmt) "smp: " fmt
+
+#include <common.h>
+#include <init.h>
+#include <clock.h>
+#include <of.h>
+#include <smp_pool.h>
+#include <linux/sizes.h>
+#include <asm/cache.h>
+#include <asm/psci.h>
+#include <asm/pgtable64.h>
+#include <asm/system.h>
+
+#include "mmu_64.h"
+
+#define SMP_64_STACK_SIZE	SZ_32K
+#define MPIDR_HWID_MASK		0xff00ffffffUL
+
+/* keep in sync with smp_entry_64.S */
+struct smp_64_boot {
+	u64 ttbr;
+	u64 tcr;
+	u64 mair;
+	u64 sctlr;
+	u64 vbar;
+	u64 sp;
+	u64 cpu;
+} __aligned(64);
+
+static_assert(offsetof(struct smp_64_boot, mair) == 16);
+static_assert(offsetof(struct smp_64_boot, vbar) == 32);
+static_assert(offsetof(struct smp_64_boot, cpu) == 48);
+
+void smp_64_save_context(struct smp_64_boot *boot);
+void smp_64_secondary_entry(void);
+
+static u64 *smp_64_mpidr;
+static struct smp_64_boot *smp_64_boot;
+
+static int smp_64_cpu_start(unsigned int cpu)
+{
+	struct smp_64_boot *boot = &smp_64_boot[cpu];
+
+	if (!boot->sp)
+		boot->sp = (ulong)xmemalign(16, SMP_64_STACK_SIZE) + SMP_64_STACK_SIZE;
+
+	smp_64_save_context(boot);
+	boot->cpu = cpu;
+
+	/* the secondary reads this with its MMU and caches still off */
+	v8_flush_dcache_range((ulong)boot, (ulong)(boot + 1));
+
+	return psci_invoke(ARM_PSCI_0_2_FN64_CPU_ON, smp_64_mpidr[cpu],
+			   (ulong)smp_64_secondary_entry, (ulong)boot, NULL);
+}
+
+static void __noreturn smp_64_cpu_exit(unsigned int cpu)
+{
+	psci_invoke(ARM_PSCI_0_2_FN_CPU_OFF, 0, 0, 0, NULL);
+
+	/* CPU_OFF doesn't return on success */
+	while (1)
+		asm volatile("wfi");
+}
+
+static int smp_64_cpu_wait_off(unsigned int cpu)
+{
+	uint64_t start = get_time_ns();
+	int ret;
+
+	do {
+		ret = psci_invoke(ARM_PSCI_0_2_FN64_AFFINITY_INFO,
+				  smp_64_mpidr[cpu], 0, 0, NULL);
+		if (ret == PSCI_AFFINITY_LEVEL_OFF)
+			return 0;
+		if (ret < 0)
+			return ret;
+	} while (!is_timeout_non_interruptible(start, 100 * MSECOND));
+
+	return -ETIMEDOUT;
+}
+
+static void smp_64_wait(void)
+{
+	asm volatile("wfe" : : : "memory");
+}
+
+static void smp_64_kick(void)
+{
+	asm volatile("dsb ishst\n\tsev" : : : "memory");
+}
+
+/* remap_range() only invalidates the TLB of the boot CPU */
+static void smp_64_sync(void)
+{
+	tlb_invalidate();
+}
+
+static const struct smp_pool_ops smp_64_ops = {
+	.cpu_start = smp_64_cpu_start,
+	.cpu_exit = smp_64_cpu_exit,
+	.cpu_wait_off = smp_64_cpu_wait_off,
+	.wait = smp_64_wait,
+	.kick = smp_64_kick,
+	.sync = smp_64_sync,
+};
+
+static bool smp_64_is_cpu(struct device_node *np)
+{
+	const char *type = of_get_property(np, "device_type", NULL);
+
+	return type && !strcmp(type, "cpu");
+}
+
+static int smp_64_init(void)
+{
+	struct device_node *cpus, *cpu;
+	u64 self = read_mpidr() & MPIDR_HWID_MASK;
+	unsigned int ncpus = 1, max = 1;
+	int ret;
+
+	if (psci_get_version() < ARM_PSCI_VER_0_2)
+		return 0;
+
+	cpus = of_find_node_by_path("/cpus");
+	if (!cpus)
+		return 0;
+
+	for_each_child_of_node(cpus, cpu)
+		if (smp_64_is_cpu(cpu))
+			max++;
+
+	smp_64_mpidr = xzalloc(max * sizeof(*smp_64_mpidr));
+	smp_64_mpidr[0] = self;
+
+	for_each_child_of_node(cpus, cpu) {
+		const __be32 *reg;
+		u64 hwid;
+		int len, na;
+
+		if (!smp_64_is_cpu(cpu) || !of_device_is_available(cpu))
+			continue;
+
+		na = of_n_addr_cells(cpu);
+		reg = of_get_property(cpu, "reg", &len);
+		if (!reg || len < na * sizeof(*reg))
+			continue;
+
+		hwid = of_read_number(reg, na) & MPIDR_HWID_MASK;
+		if (hwid == self)
+			continue;
+
+		smp_64_mpidr[ncpus++] = hwid;
+	}
+
+	if (ncpus < 2) {
+		free(smp_64_mpidr);
+		return 0;
+	}
+
+	smp_64_boot = xmemalign(64, ncpus * sizeof(*smp_64_boot));
+	memset(smp_64_boot, 0, ncpus * sizeof(*smp_64_boot));
+
+	ret = smp_pool_register(&smp_64_ops, ncpus);
+	if (ret)
+		pr_warn("failed to register worker pool: %pe\n", ERR_PTR(ret));
+
+	return 0;
+}
+device_initcall(smp_64_init);
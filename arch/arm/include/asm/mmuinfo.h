@@ -5,5 +5,6 @@
 
 int mmuinfo_v7(void *addr);
 int mmuinfo_v8(void *addr);
+int mmuinfo_v8_stats(void);
 
 #endif
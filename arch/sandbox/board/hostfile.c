@@ -26,6 +26,7 @@
 #include <mach/hostfile.h>
 #include <featctrl.h>
 #include <xfuncs.h>
+#include <fs.h>
 
 struct hf_priv {
 	union {
@@ -34,6 +35,8 @@ struct hf_priv {
 	};
 	const char *filename;
 	int fd;
+	void *base;
+	bool is_readonly;
 	struct feature_controller feat;
 };
 
@@ -67,9 +70,24 @@ static ssize_t hf_cdev_write(struct cdev *cdev, const void *buf, size_t count, l
 	return hf_write(cdev->priv, buf, count, offset, flags);
 }
 
+static int hf_cdev_memmap(struct cdev *cdev, void **map, int flags)
+{
+	struct hf_priv *priv = cdev->priv;
+
+	if (priv->base == MAP_FAILED)
+		return -EINVAL;
+	if ((flags & PROT_WRITE) && priv->is_readonly)
+		return -EACCES;
+
+	*map = priv->base;
+
+	return 0;
+}
+
 static struct cdev_operations hf_cdev_ops = {
 	.read  = hf_cdev_read,
 	.write = hf_cdev_write,
+	.memmap = hf_cdev_memmap,
 };
 
 static int hf_blk_read(struct block_device *blk, void *buf, sector_t block, blkcnt_t num_blocks)
@@ -139,6 +157,9 @@ static int hf_probe(struct device *dev)
 
 	of_property_read_u32(np, "barebox,fd", &priv->fd);
 
+	priv->base = (void *)(unsigned long)reg[0];
+	priv->is_readonly = of_property_read_bool(np, "barebox,read-only");
+
 	err = of_property_read_string(np, "barebox,filename",
 				      &priv->filename);
 	if (err)
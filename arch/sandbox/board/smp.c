@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <common.h>
+#include <init.h>
+#include <smp_pool.h>
+#include <mach/linux.h>
+
+static int sandbox_smp_cpu_start(unsigned int cpu)
+{
+	return linux_smp_start(cpu, smp_pool_secondary_main) ? -EIO : 0;
+}
+
+static void __noreturn sandbox_smp_cpu_exit(unsigned int cpu)
+{
+	linux_smp_exit();
+}
+
+static int sandbox_smp_cpu_wait_off(unsigned int cpu)
+{
+	return linux_smp_join(cpu) ? -EIO : 0;
+}
+
+static void sandbox_smp_kick(void)
+{
+}
+
+static const struct smp_pool_ops sandbox_smp_ops = {
+	.cpu_start = sandbox_smp_cpu_start,
+	.cpu_exit = sandbox_smp_cpu_exit,
+	.cpu_wait_off = sandbox_smp_cpu_wait_off,
+	.wait = linux_smp_yield,
+	.kick = sandbox_smp_kick,
+};
+
+static int sandbox_smp_init(void)
+{
+	int ncpus = linux_smp_cpus();
+
+	if (ncpus < 2)
+		return 0;
+
+	return smp_pool_register(&sandbox_smp_ops, ncpus);
+}
+device_initcall(sandbox_smp_init);
@@ -30,6 +30,12 @@ int linux_execve(const char * filename, char *const argv[], char *const envp[]);
 
 int linux_watchdog_set_timeout(unsigned int timeout);
 
+int linux_smp_cpus(void);
+int linux_smp_start(unsigned int cpu, void (*fn)(unsigned int cpu));
+void __attribute__((noreturn)) linux_smp_exit(void);
+int linux_smp_join(unsigned int cpu);
+void linux_smp_yield(void);
+
 int barebox_register_console(int stdinfd, int stdoutfd);
 
 int barebox_register_dtb(const void *dtb);
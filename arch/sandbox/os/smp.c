@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * pthread backend for the sandbox secondary CPU worker pool
+ */
+
+/*
+ * These are host includes. Never include any barebox header
+ * files here...
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define SANDBOX_SMP_MAX_CPUS	8
+
+static pthread_t threads[SANDBOX_SMP_MAX_CPUS];
+
+struct smp_start {
+	void (*fn)(unsigned int cpu);
+	unsigned int cpu;
+};
+
+static struct smp_start starts[SANDBOX_SMP_MAX_CPUS];
+
+int linux_smp_cpus(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		return 1;
+
+	return n < SANDBOX_SMP_MAX_CPUS ? n : SANDBOX_SMP_MAX_CPUS;
+}
+
+static void *linux_smp_thread(void *arg)
+{
+	struct smp_start *start = arg;
+	sigset_t sigs;
+
+	/* leave all signal handling to the barebox main thread */
+	sigfillset(&sigs);
+	pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+	start->fn(start->cpu);
+
+	return NULL;
+}
+
+int linux_smp_start(unsigned int cpu, void (*fn)(unsigned int cpu))
+{
+	if (cpu >= SANDBOX_SMP_MAX_CPUS)
+		return -1;
+
+	starts[cpu].fn = fn;
+	starts[cpu].cpu = cpu;
+
+	return pthread_create(&threads[cpu], NULL, linux_smp_thread,
+			      &starts[cpu]) ? -1 : 0;
+}
+
+void __attribute__((noreturn)) linux_smp_exit(void)
+{
+	pthread_exit(NULL);
+}
+
+int linux_smp_join(unsigned int cpu)
+{
+	return pthread_join(threads[cpu], NULL) ? -1 : 0;
+}
+
+void linux_smp_yield(void)
+{
+	sched_yield();
+}
@@ -3,13 +3,23 @@
 /**
  * @file
  * @brief x86 specific string optimizations
- *
- * Thanks to the Linux kernel here we can add many micro optimized string
- * functions. But currently it makes no sense, to do so.
  */
 #ifndef __ASM_X86_STRING_H
 #define __ASM_X86_STRING_H
 
-/* nothing special yet */
+#ifdef CONFIG_X86_OPTIMZED_STRING_FUNCTIONS
+
+#define __HAVE_ARCH_MEMCPY
+extern void *memcpy(void *, const void *, __kernel_size_t);
+#define __HAVE_ARCH_MEMSET
+extern void *memset(void *, int, __kernel_size_t);
+#define __HAVE_ARCH_MEMMOVE
+extern void *memmove(void *, const void *, __kernel_size_t);
+
+#endif
+
+extern void *__memcpy(void *, const void *, __kernel_size_t);
+extern void *__memset(void *, int, __kernel_size_t);
+extern void *__memmove(void *, const void *, __kernel_size_t);
 
 #endif
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * memcpy() and memset() using the x86 string instructions. barebox is
+ * built without SSE for EFI, and on CPUs with ERMS (enhanced rep movsb/
+ * stosb) these move whole cache lines at a time, which no general
+ * purpose register loop gets close to.
+ */
+
+#include <common.h>
+#include <string.h>
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+	void *d = dest;
+
+	asm volatile("rep movsb"
+		     : "+D" (d), "+S" (src), "+c" (count)
+		     : : "memory");
+
+	return dest;
+}
+
+void *__memcpy(void *dest, const void *src, size_t count)
+	__alias(memcpy);
+
+void *memset(void *s, int c, size_t count)
+{
+	void *d = s;
+
+	asm volatile("rep stosb"
+		     : "+D" (d), "+c" (count)
+		     : "a" (c)
+		     : "memory");
+
+	return s;
+}
+
+void *__memset(void *s, int c, size_t count)
+	__alias(memset);
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+	/* a forward copy is fine unless dest overlaps the end of src */
+	if (dest <= src || dest >= src + count)
+		return memcpy(dest, src, count);
+
+	/* backwards rep movsb is not fast, use the generic word loop */
+	return __default_memmove(dest, src, count);
+}
+
+void *__memmove(void *dest, const void *src, size_t count)
+	__alias(memmove);
@@ -57,6 +57,8 @@ static int do_devinfo(int argc, char *argv[])
 			if (!dev->parent)
 				do_devinfo_subtree(dev, 0);
 		}
+
+		device_print_deferred_stats();
 	} else {
 		dev = get_device_by_name(argv[1]);
 		if (!dev)
@@ -82,6 +84,13 @@ static int do_devinfo(int argc, char *argv[])
 		if (dev->bus)
 			printf("Bus: %s\n", dev->bus->name);
 
+		if (dev->deferred_count) {
+			printf("Probe deferred: %u times", dev->deferred_count);
+			if (dev->deferred_supplier)
+				printf(", waiting for %pOF", dev->deferred_supplier);
+			printf("\n");
+		}
+
 		if (dev->info)
 			dev->info(dev);
 
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <common.h>
+#include <command.h>
+#include <getopt.h>
+#include <initcall_report.h>
+
+static int do_initcalls(int argc, char *argv[])
+{
+	unsigned int max = 20;
+	bool drivers = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "adn:")) > 0) {
+		switch (opt) {
+		case 'a':
+			max = 0;
+			break;
+		case 'd':
+			drivers = true;
+			break;
+		case 'n':
+			max = simple_strtoul(optarg, NULL, 0);
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	initcall_report_print(max, drivers);
+
+	return 0;
+}
+
+BAREBOX_CMD_HELP_START(initcalls)
+BAREBOX_CMD_HELP_TEXT("List the initcalls that took the most time, including the")
+BAREBOX_CMD_HELP_TEXT("driver registrations and probes they triggered. Initcalls")
+BAREBOX_CMD_HELP_TEXT("skipped by a machine guard are marked as such.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT("-d", "list driver registrations instead of initcalls")
+BAREBOX_CMD_HELP_OPT("-n NUM", "list NUM entries (default 20)")
+BAREBOX_CMD_HELP_OPT("-a", "list all entries")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(initcalls)
+	.cmd		= do_initcalls,
+	BAREBOX_CMD_DESC("show initcall and driver registration cost")
+	BAREBOX_CMD_OPTS("[-adn]")
+	BAREBOX_CMD_GROUP(CMD_GRP_INFO)
+	BAREBOX_CMD_HELP(cmd_initcalls_help)
+BAREBOX_CMD_END
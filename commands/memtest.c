@@ -13,7 +13,7 @@
 #include <mmu.h>
 
 static int do_test_one_area(struct mem_test_resource *r, int bus_only,
-		unsigned cache_flag)
+		int patterns, unsigned cache_flag)
 {
 	unsigned flags = MEMTEST_VERBOSE;
 	int ret;
@@ -33,19 +33,25 @@ static int do_test_one_area(struct mem_test_resource *r, int bus_only,
 	ret = mem_test_moving_inversions(r->r->start, r->r->end, flags);
 	if (ret < 0)
 		return ret;
+
+	if (patterns) {
+		ret = mem_test_patterns(r->r->start, r->r->end, flags);
+		if (ret < 0)
+			return ret;
+	}
 	printf("done.\n\n");
 
 	return 0;
 }
 
 static int do_memtest_thorough(struct list_head *memtest_regions,
-		int bus_only, unsigned cache_flag)
+		int bus_only, int patterns, unsigned cache_flag)
 {
 	struct mem_test_resource *r;
 	int ret;
 
 	list_for_each_entry(r, memtest_regions, list) {
-		ret = do_test_one_area(r, bus_only, cache_flag);
+		ret = do_test_one_area(r, bus_only, patterns, cache_flag);
 		if (ret)
 			return ret;
 	}
@@ -54,7 +60,7 @@ static int do_memtest_thorough(struct list_head *memtest_regions,
 }
 
 static int do_memtest_biggest(struct list_head *memtest_regions,
-		int bus_only, unsigned cache_flag)
+		int bus_only, int patterns, unsigned cache_flag)
 {
 	struct mem_test_resource *r;
 
@@ -62,20 +68,20 @@ static int do_memtest_biggest(struct list_head *memtest_regions,
 	if (!r)
 		return -EINVAL;
 
-	return do_test_one_area(r, bus_only, cache_flag);
+	return do_test_one_area(r, bus_only, patterns, cache_flag);
 }
 
 static int do_memtest(int argc, char *argv[])
 {
-	int bus_only = 0, ret, opt;
+	int bus_only = 0, patterns = 0, ret, opt;
 	uint32_t i, max_i = 1;
 	struct list_head memtest_used_regions;
-	int (*memtest)(struct list_head *, int, unsigned);
+	int (*memtest)(struct list_head *, int, int, unsigned);
 	int cached = 0, uncached = 0;
 
 	memtest = do_memtest_biggest;
 
-	while ((opt = getopt(argc, argv, "i:btcu")) > 0) {
+	while ((opt = getopt(argc, argv, "i:btcup")) > 0) {
 		switch (opt) {
 		case 'i':
 			max_i = simple_strtoul(optarg, NULL, 0);
@@ -92,6 +98,9 @@ static int do_memtest(int argc, char *argv[])
 		case 'u':
 			uncached = 1;
 			break;
+		case 'p':
+			patterns = 1;
+			break;
 		default:
 			return COMMAND_ERROR_USAGE;
 		}
@@ -121,7 +130,7 @@ static int do_memtest(int argc, char *argv[])
 		if (cached) {
 			printf("Do memtest with caching enabled.\n");
 			ret = memtest(&memtest_used_regions,
-					bus_only, MAP_CACHED);
+					bus_only, patterns, MAP_CACHED);
 			if (ret < 0)
 				goto out;
 		}
@@ -129,14 +138,14 @@ static int do_memtest(int argc, char *argv[])
 		if (uncached) {
 			printf("Do memtest with caching disabled.\n");
 			ret = memtest(&memtest_used_regions,
-					bus_only, MAP_UNCACHED);
+					bus_only, patterns, MAP_UNCACHED);
 			if (ret < 0)
 				goto out;
 		}
 
 		if (!cached && !uncached) {
 			ret = memtest(&memtest_used_regions,
-					bus_only, MAP_DEFAULT);
+					bus_only, patterns, MAP_DEFAULT);
 			if (ret < 0)
 				goto out;
 		}
@@ -169,12 +178,13 @@ BAREBOX_CMD_HELP_OPT("-b", "perform only a test on bus lines")
 BAREBOX_CMD_HELP_OPT("-c", "cached. Test using cached memory")
 BAREBOX_CMD_HELP_OPT("-u", "uncached. Test using uncached memory")
 BAREBOX_CMD_HELP_OPT("-t", "thorough. test all free areas. If unset, only test biggest free area")
+BAREBOX_CMD_HELP_OPT("-p", "additionally test with solid bits, checkerboard, walking bits, bit spread and random patterns")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(memtest)
 	.cmd		= do_memtest,
 	BAREBOX_CMD_DESC("extensive memory test")
-	BAREBOX_CMD_OPTS("[-ibcut]")
+	BAREBOX_CMD_OPTS("[-ibcutp]")
 	BAREBOX_CMD_GROUP(CMD_GRP_MEM)
 	BAREBOX_CMD_HELP(cmd_memtest_help)
 BAREBOX_CMD_END
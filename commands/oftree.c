@@ -33,12 +33,13 @@ static int do_oftree(int argc, char *argv[])
 	struct fdt_header *fdt = NULL;
 	int opt;
 	int probe = 0;
+	int info = 0;
 	char *load = NULL;
 	char *save = NULL;
 	int ret;
 	struct device_node *root;
 
-	while ((opt = getopt(argc, argv, "pfl:s:")) > 0) {
+	while ((opt = getopt(argc, argv, "pfil:s:")) > 0) {
 		switch (opt) {
 		case 'l':
 			load = optarg;
@@ -54,9 +55,17 @@ static int do_oftree(int argc, char *argv[])
 		case 's':
 			save = optarg;
 			break;
+		case 'i':
+			info = 1;
+			break;
 		}
 	}
 
+	if (info) {
+		of_lookup_stats_print();
+		return 0;
+	}
+
 	if (!probe && !load && !save)
 		return COMMAND_ERROR_USAGE;
 
@@ -104,12 +113,13 @@ BAREBOX_CMD_HELP_TEXT("Options:")
 BAREBOX_CMD_HELP_OPT ("-l <DTB>",  "Load <DTB> to internal devicetree")
 BAREBOX_CMD_HELP_OPT ("-s <DTB>",  "save internal devicetree to <DTB>")
 BAREBOX_CMD_HELP_OPT ("-p",  "probe devices from stored device tree")
+BAREBOX_CMD_HELP_OPT ("-i",  "show phandle and compatible lookup statistics")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(oftree)
 	.cmd		= do_oftree,
 	BAREBOX_CMD_DESC("handle device trees")
-	BAREBOX_CMD_OPTS("[-lsp]")
+	BAREBOX_CMD_OPTS("[-lspi]")
 	BAREBOX_CMD_GROUP(CMD_GRP_MISC)
 	BAREBOX_CMD_HELP(cmd_oftree_help)
 BAREBOX_CMD_END
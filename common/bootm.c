@@ -14,6 +14,8 @@
 #include <magicvar.h>
 #include <uncompress.h>
 #include <zero_page.h>
+#include <boottrace.h>
+#include <smp_pool.h>
 
 static LIST_HEAD(handler_list);
 
@@ -122,19 +124,7 @@ static inline bool image_is_uimage(struct image_data *data)
 	return IS_ENABLED(CONFIG_BOOTM_UIMAGE) && data->os;
 }
 
-/*
- * bootm_load_os() - load OS to RAM
- *
- * @data:		image data context
- * @load_address:	The address where the OS should be loaded to
- *
- * This loads the OS to a RAM location. load_address must be a valid
- * address. If the image_data doesn't have a OS specified it's considered
- * an error.
- *
- * Return: 0 on success, negative error code otherwise
- */
-int bootm_load_os(struct image_data *data, unsigned long load_address)
+static int __bootm_load_os(struct image_data *data, unsigned long load_address)
 {
 	if (data->os_res)
 		return 0;
@@ -155,7 +145,11 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 				(unsigned long long)load_address + kernel_size - 1);
 			return -ENOMEM;
 		}
-		zero_page_memcpy((void *)load_address, kernel, kernel_size);
+		/* secondaries don't know about the zero page trap */
+		if (load_address < PAGE_SIZE)
+			zero_page_memcpy((void *)load_address, kernel, kernel_size);
+		else
+			smp_memcpy((void *)load_address, kernel, kernel_size);
 		return 0;
 	}
 
@@ -186,6 +180,29 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 	return -EINVAL;
 }
 
+/*
+ * bootm_load_os() - load OS to RAM
+ *
+ * @data:		image data context
+ * @load_address:	The address where the OS should be loaded to
+ *
+ * This loads the OS to a RAM location. load_address must be a valid
+ * address. If the image_data doesn't have a OS specified it's considered
+ * an error.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int bootm_load_os(struct image_data *data, unsigned long load_address)
+{
+	u64 start = boottrace_start();
+	int ret;
+
+	ret = __bootm_load_os(data, load_address);
+	boottrace_record("bootm", start, "load kernel");
+
+	return ret;
+}
+
 bool bootm_has_initrd(struct image_data *data)
 {
 	if (!IS_ENABLED(CONFIG_BOOTM_INITRD))
@@ -229,20 +246,7 @@ static int bootm_open_initrd_uimage(struct image_data *data)
 	return 0;
 }
 
-/*
- * bootm_load_initrd() - load initrd to RAM
- *
- * @data:		image data context
- * @load_address:	The address where the initrd should be loaded to
- *
- * This loads the initrd to a RAM location. load_address must be a valid
- * address. If the image_data doesn't have a initrd specified this function
- * still returns successful as an initrd is optional. Check data->initrd_res
- * to see if an initrd has been loaded.
- *
- * Return: 0 on success, negative error code otherwise
- */
-int bootm_load_initrd(struct image_data *data, unsigned long load_address)
+static int __bootm_load_initrd(struct image_data *data, unsigned long load_address)
 {
 	enum filetype type;
 	int ret;
@@ -278,7 +282,7 @@ int bootm_load_initrd(struct image_data *data, unsigned long load_address)
 				(unsigned long long)load_address + initrd_size - 1);
 			return -ENOMEM;
 		}
-		memcpy((void *)load_address, initrd, initrd_size);
+		smp_memcpy((void *)load_address, initrd, initrd_size);
 		pr_info("Loaded initrd from FIT image\n");
 		goto done1;
 	}
@@ -327,6 +331,30 @@ int bootm_load_initrd(struct image_data *data, unsigned long load_address)
 	return 0;
 }
 
+/*
+ * bootm_load_initrd() - load initrd to RAM
+ *
+ * @data:		image data context
+ * @load_address:	The address where the initrd should be loaded to
+ *
+ * This loads the initrd to a RAM location. load_address must be a valid
+ * address. If the image_data doesn't have a initrd specified this function
+ * still returns successful as an initrd is optional. Check data->initrd_res
+ * to see if an initrd has been loaded.
+ *
+ * Return: 0 on success, negative error code otherwise
+ */
+int bootm_load_initrd(struct image_data *data, unsigned long load_address)
+{
+	u64 start = boottrace_start();
+	int ret;
+
+	ret = __bootm_load_initrd(data, load_address);
+	boottrace_record("bootm", start, "load initrd");
+
+	return ret;
+}
+
 static int bootm_open_oftree_uimage(struct image_data *data, size_t *size,
 				    struct fdt_header **fdt)
 {
@@ -384,6 +412,7 @@ void *bootm_get_devicetree(struct image_data *data)
 {
 	enum filetype type;
 	struct fdt_header *oftree;
+	u64 start;
 	int ret;
 
 	if (!IS_ENABLED(CONFIG_OFTREE))
@@ -454,9 +483,14 @@ void *bootm_get_devicetree(struct image_data *data)
 		of_add_reserve_entry(data->initrd_res->start, data->initrd_res->end);
 	}
 
+	start = boottrace_start();
+
 	of_fix_tree(data->of_root_node);
 
 	oftree = of_flatten_dtb(data->of_root_node);
+
+	boottrace_record("bootm", start, "devicetree fixup");
+
 	if (!oftree)
 		return ERR_PTR(-EINVAL);
 
@@ -690,6 +724,7 @@ int bootm_boot(struct bootm_data *bootm_data)
 	int ret;
 	enum filetype os_type;
 	size_t size;
+	u64 start;
 
 	if (!bootm_data->os_file) {
 		pr_err("no image given\n");
@@ -745,6 +780,8 @@ int bootm_boot(struct bootm_data *bootm_data)
 		}
 	}
 
+	start = boottrace_start();
+
 	switch (os_type) {
 	case filetype_oftree:
 		ret = bootm_open_fit(data);
@@ -760,6 +797,8 @@ int bootm_boot(struct bootm_data *bootm_data)
 		break;
 	}
 
+	boottrace_record("bootm", start, "open %s", data->os_file);
+
 	if (ret) {
 		const char *os_type_str;
 
@@ -890,6 +929,13 @@ int bootm_boot(struct bootm_data *bootm_data)
 		printf("Passing control to %s handler\n", handler->name);
 	}
 
+	/* don't start an OS while a secondary CPU may still run barebox code */
+	ret = smp_pool_park();
+	if (ret) {
+		pr_err("cannot power down secondary CPUs: %pe\n", ERR_PTR(ret));
+		goto err_out;
+	}
+
 	ret = handler->bootm(data);
 	if (data->dryrun)
 		pr_info("Dryrun. Aborted\n");
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * boottrace.c - record boot time events in a ring buffer
+ *
+ * Events are exported in Chrome trace event format through /dev/boottrace,
+ * so that they can be loaded into chrome://tracing, Perfetto or converted
+ * to flamegraphs.
+ */
+
+#define pr_fmt(fmt) "boottrace: " fmt
+
+#include <common.h>
+#include <boottrace.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <stdio.h>
+
+#define BOOTTRACE_NAME_LEN	48
+
+struct boottrace_event {
+	u64 start;
+	u64 duration;
+	const char *category;
+	char name[BOOTTRACE_NAME_LEN];
+};
+
+static struct boottrace_event boottrace_events[CONFIG_BOOTTRACE_EVENTS];
+/* total number of events recorded, including overwritten ones */
+static unsigned int boottrace_num;
+
+void boottrace_record(const char *category, u64 start, const char *fmt, ...)
+{
+	struct boottrace_event *ev;
+	va_list args;
+
+	ev = &boottrace_events[boottrace_num % CONFIG_BOOTTRACE_EVENTS];
+	boottrace_num++;
+
+	ev->duration = get_time_ns() - start;
+	ev->start = start;
+	ev->category = category;
+
+	va_start(args, fmt);
+	vsnprintf(ev->name, sizeof(ev->name), fmt, args);
+	va_end(args);
+}
+EXPORT_SYMBOL(boottrace_record);
+
+static char *boottrace_json_string(char *p, const char *str)
+{
+	*p++ = '"';
+
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			*p++ = '\\';
+		*p++ = (unsigned char)*str < ' ' ? ' ' : *str;
+	}
+
+	*p++ = '"';
+
+	return p;
+}
+
+/*
+ * Render the recorded events oldest first as Chrome trace "complete"
+ * events. Timestamps are given in microseconds.
+ */
+static char *boottrace_to_json(size_t *size)
+{
+	unsigned int i, num, first;
+	char *buf, *p;
+
+	num = min_t(unsigned int, boottrace_num, CONFIG_BOOTTRACE_EVENTS);
+	first = boottrace_num - num;
+
+	buf = malloc(num * (2 * BOOTTRACE_NAME_LEN + 192) + 128);
+	if (!buf)
+		return NULL;
+
+	p = buf;
+	p += sprintf(p, "{\"otherData\":{\"dropped\":%u},\"traceEvents\":[",
+		     first);
+
+	for (i = 0; i < num; i++) {
+		struct boottrace_event *ev;
+
+		ev = &boottrace_events[(first + i) % CONFIG_BOOTTRACE_EVENTS];
+
+		p += sprintf(p, "%s\n{\"name\":", i ? "," : "");
+		p = boottrace_json_string(p, ev->name);
+		p += sprintf(p, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,"
+			     "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu}",
+			     ev->category,
+			     ev->start / 1000, ev->start % 1000,
+			     ev->duration / 1000, ev->duration % 1000);
+	}
+
+	p += sprintf(p, "\n]}\n");
+
+	*size = p - buf;
+
+	return buf;
+}
+
+struct boottrace_file {
+	struct cdev cdev;
+	char *buf;
+	size_t size;
+};
+
+static int boottrace_open(struct cdev *cdev, unsigned long flags)
+{
+	struct boottrace_file *bf = cdev->priv;
+
+	if (bf->buf)
+		return -EBUSY;
+
+	bf->buf = boottrace_to_json(&bf->size);
+	if (!bf->buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int boottrace_close(struct cdev *cdev)
+{
+	struct boottrace_file *bf = cdev->priv;
+
+	free(bf->buf);
+	bf->buf = NULL;
+
+	return 0;
+}
+
+static ssize_t boottrace_read(struct cdev *cdev, void *buf, size_t count,
+			      loff_t offset, ulong flags)
+{
+	struct boottrace_file *bf = cdev->priv;
+
+	if (offset >= bf->size)
+		return 0;
+
+	count = min_t(size_t, count, bf->size - offset);
+	memcpy(buf, bf->buf + offset, count);
+
+	return count;
+}
+
+static struct cdev_operations boottrace_ops = {
+	.open = boottrace_open,
+	.close = boottrace_close,
+	.read = boottrace_read,
+};
+
+static struct boottrace_file boottrace_file;
+
+static int boottrace_init(void)
+{
+	struct cdev *cdev = &boottrace_file.cdev;
+
+	cdev->name = "boottrace";
+	cdev->flags = DEVFS_IS_CHARACTER_DEV;
+	cdev->ops = &boottrace_ops;
+	cdev->priv = &boottrace_file;
+
+	return devfs_create(cdev);
+}
+late_initcall(boottrace_init);
@@ -17,10 +17,34 @@
 #include <init.h>
 #include <complete.h>
 #include <getopt.h>
+#include <linux/bsearch.h>
 
 LIST_HEAD(command_list);
 EXPORT_SYMBOL(command_list);
 
+/*
+ * The linker sorts the commands built into barebox by name, see
+ * BAREBOX_CMDS, so they are looked up by bisecting __barebox_cmd_start[]
+ * directly and need no registration. Commands registered at runtime and
+ * the aliases of all commands are kept in a hash table and take
+ * precedence over the builtin ones. command_list, which has all of them
+ * in order, is only set up once something iterates over the commands.
+ */
+#define COMMAND_HASH_BITS	6
+
+static struct hlist_head command_hash[1 << COMMAND_HASH_BITS];
+static bool command_table_ready, command_table_unsorted, command_list_ready;
+
+static struct hlist_head *command_hash_bucket(const char *name)
+{
+	return &command_hash[strhash(name) & ((1 << COMMAND_HASH_BITS) - 1)];
+}
+
+static unsigned int builtin_cmd_num(void)
+{
+	return __barebox_cmd_end - __barebox_cmd_start;
+}
+
 void barebox_cmd_usage(struct command *cmdtp)
 {
 	putchar('\n');
@@ -78,18 +102,10 @@ int execute_command(int argc, char **argv)
 	return ret;
 }
 
-int register_command(struct command *cmd)
-{
-	/*
-	 * We do not check if the command already exists.
-	 * This allows us to overwrite a builtin command
-	 * with a module.
-	 */
-
-	debug("register command %s\n", cmd->name);
-
-	list_add_sort(&cmd->list, &command_list, compare);
+static void command_add(struct command *cmd);
 
+static void command_add_aliases(struct command *cmd)
+{
 	if (cmd->aliases) {
 		const char * const *aliases = cmd->aliases;
 		while(*aliases) {
@@ -103,16 +119,88 @@ int register_command(struct command *cmd)
 
 			c->aliases = NULL;
 
-			register_command(c);
+			command_add(c);
 
 			aliases++;
 		}
 	}
+}
+
+static void command_add(struct command *cmd)
+{
+	hlist_add_head(&cmd->hash, command_hash_bucket(cmd->name));
+
+	if (command_list_ready)
+		list_add_sort(&cmd->list, &command_list, compare);
+
+	command_add_aliases(cmd);
+}
+
+static void command_table_init(void)
+{
+	struct command * const *cmdtp;
+	unsigned int i, n = builtin_cmd_num();
+
+	if (command_table_ready)
+		return;
+
+	command_table_ready = true;
+
+	for (i = 1; i < n; i++) {
+		if (strcmp(__barebox_cmd_start[i - 1]->name,
+			   __barebox_cmd_start[i]->name) > 0) {
+			pr_warn("command table not sorted, falling back to linear search\n");
+			command_table_unsorted = true;
+			break;
+		}
+	}
+
+	for (cmdtp = __barebox_cmd_start; cmdtp != __barebox_cmd_end; cmdtp++)
+		command_add_aliases(*cmdtp);
+}
+
+int register_command(struct command *cmd)
+{
+	/*
+	 * We do not check if the command already exists.
+	 * This allows us to overwrite a builtin command
+	 * with a module.
+	 */
+
+	debug("register command %s\n", cmd->name);
+
+	command_table_init();
+	command_add(cmd);
 
 	return 0;
 }
 EXPORT_SYMBOL(register_command);
 
+static int builtin_cmd_cmp(const void *name, const void *elem)
+{
+	const struct command * const *cmdtp = elem;
+
+	return strcmp(name, (*cmdtp)->name);
+}
+
+static struct command *find_builtin_cmd(const char *cmd)
+{
+	struct command * const *cmdtp;
+
+	if (command_table_unsorted) {
+		for (cmdtp = __barebox_cmd_start; cmdtp != __barebox_cmd_end; cmdtp++)
+			if (!strcmp(cmd, (*cmdtp)->name))
+				return *cmdtp;
+
+		return NULL;
+	}
+
+	cmdtp = __inline_bsearch(cmd, __barebox_cmd_start, builtin_cmd_num(),
+				 sizeof(*cmdtp), builtin_cmd_cmp);
+
+	return cmdtp ? *cmdtp : NULL;
+}
+
 /*
  * find command table entry for a command
  */
@@ -120,30 +208,45 @@ struct command *find_cmd (const char *cmd)
 {
 	struct command *cmdtp;
 
-	for_each_command(cmdtp)
+	command_table_init();
+
+	hlist_for_each_entry(cmdtp, command_hash_bucket(cmd), hash)
 		if (!strcmp(cmd, cmdtp->name))
 			return cmdtp;
 
-	return NULL;	/* not found or ambiguous command */
+	return find_builtin_cmd(cmd);
 }
 EXPORT_SYMBOL(find_cmd);
 
-/*
- * Put all commands into a linked list. Without module support we could use
- * the raw command array, but with module support a list is easier to handle.
- * It does not create significant overhead so do it also without module
- * support.
+/**
+ * command_list_get - get the list of all commands sorted by name
+ *
+ * Used by for_each_command(). The list is set up on first use, which
+ * is only needed for listing and completing commands.
  */
-static int init_command_list(void)
+struct list_head *command_list_get(void)
 {
 	struct command * const *cmdtp;
+	struct command *cmd;
+	unsigned int i;
 
-	for (cmdtp = __barebox_cmd_start;
-			cmdtp != __barebox_cmd_end;
-			cmdtp++)
-		register_command(*cmdtp);
+	if (command_list_ready)
+		return &command_list;
 
-	return 0;
-}
+	command_table_init();
+
+	for (cmdtp = __barebox_cmd_start; cmdtp != __barebox_cmd_end; cmdtp++) {
+		if (command_table_unsorted)
+			list_add_sort(&(*cmdtp)->list, &command_list, compare);
+		else
+			list_add_tail(&(*cmdtp)->list, &command_list);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(command_hash); i++)
+		hlist_for_each_entry(cmd, &command_hash[i], hash)
+			list_add_sort(&cmd->list, &command_list, compare);
 
-late_initcall(init_command_list);
+	command_list_ready = true;
+
+	return &command_list;
+}
@@ -18,6 +18,7 @@
 #include <kfifo.h>
 #include <module.h>
 #include <sched.h>
+#include <poller.h>
 #include <ratp_bb.h>
 #include <magicvar.h>
 #include <globalvar.h>
@@ -46,6 +47,156 @@ static struct kfifo __console_output_fifo;
 static struct kfifo *console_input_fifo = &__console_input_fifo;
 static struct kfifo *console_output_fifo = &__console_output_fifo;
 
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+/*
+ * Consoles that can take output without waiting for the transmitter,
+ * i.e. that implement ->write(), get a TX ring. Output is queued there
+ * and handed to the hardware in chunks whenever it can take more: right
+ * away, from a poller and when the ring runs full, so printing only
+ * waits for the UART once it is CONFIG_CONSOLE_TX_BUFFER_SIZE behind.
+ */
+static struct poller_struct console_tx_poller;
+
+/*
+ * Returns a negative error code if the console failed. The queued output
+ * is dropped then, so that nobody waits for the ring to drain forever.
+ */
+static int console_tx_push(struct console_device *cdev)
+{
+	struct kfifo *fifo = cdev->tx_fifo;
+	unsigned int off, len;
+	int n;
+
+	while (kfifo_len(fifo)) {
+		off = fifo->out & (fifo->size - 1);
+		len = min(kfifo_len(fifo), fifo->size - off);
+
+		n = cdev->write(cdev, (const char *)fifo->buffer + off, len);
+		if (n < 0) {
+			kfifo_reset(fifo);
+			return n;
+		}
+		if (!n)
+			break;
+
+		fifo->out += n;
+	}
+
+	return 0;
+}
+
+static void console_tx_drain(struct console_device *cdev)
+{
+	if (!cdev->tx_fifo)
+		return;
+
+	while (kfifo_len(cdev->tx_fifo)) {
+		if (console_tx_push(cdev) < 0)
+			break;
+	}
+}
+
+static void console_tx_queue(struct console_device *cdev, const char *s,
+			     size_t nbytes)
+{
+	unsigned int n;
+
+	while (nbytes) {
+		n = kfifo_put(cdev->tx_fifo, (const unsigned char *)s, nbytes);
+		s += n;
+		nbytes -= n;
+
+		if (nbytes && console_tx_push(cdev) < 0)
+			return;
+	}
+}
+
+static int console_tx_puts(struct console_device *cdev, const char *s,
+			   size_t nbytes)
+{
+	const char *end = s + nbytes, *nl;
+
+	while ((nl = memchr(s, '\n', end - s))) {
+		console_tx_queue(cdev, s, nl - s);
+		console_tx_queue(cdev, "\r\n", 2);
+		s = nl + 1;
+
+		if (IS_ENABLED(CONFIG_CONSOLE_FLUSH_LINE_BREAK)) {
+			console_tx_drain(cdev);
+			if (cdev->flush)
+				cdev->flush(cdev);
+		}
+	}
+
+	console_tx_queue(cdev, s, end - s);
+	console_tx_push(cdev);
+
+	return nbytes;
+}
+
+static void console_tx_poll(struct poller_struct *poller)
+{
+	struct console_device *cdev;
+
+	for_each_console(cdev) {
+		if (cdev->tx_fifo)
+			console_tx_push(cdev);
+	}
+}
+
+static void console_tx_init(struct console_device *cdev)
+{
+	/* drivers with their own ->puts() do their own buffering */
+	if (!cdev->write || cdev->puts)
+		return;
+
+	cdev->tx_fifo = kfifo_alloc(CONFIG_CONSOLE_TX_BUFFER_SIZE);
+	if (!cdev->tx_fifo)
+		return;
+
+	if (!console_tx_poller.registered) {
+		console_tx_poller.func = console_tx_poll;
+		poller_register(&console_tx_poller, "console-tx");
+	}
+}
+
+static void console_tx_exit(struct console_device *cdev)
+{
+	if (!cdev->tx_fifo)
+		return;
+
+	console_tx_drain(cdev);
+	kfifo_free(cdev->tx_fifo);
+	cdev->tx_fifo = NULL;
+}
+#else
+static inline void console_tx_drain(struct console_device *cdev)
+{
+}
+
+static inline int console_tx_puts(struct console_device *cdev, const char *s,
+				  size_t nbytes)
+{
+	return 0;
+}
+
+static inline void console_tx_init(struct console_device *cdev)
+{
+}
+
+static inline void console_tx_exit(struct console_device *cdev)
+{
+}
+#endif
+
+static void console_flush_one(struct console_device *cdev)
+{
+	console_tx_drain(cdev);
+
+	if (cdev->flush)
+		cdev->flush(cdev);
+}
+
 int console_open(struct console_device *cdev)
 {
 	int ret;
@@ -88,8 +239,8 @@ int console_set_active(struct console_device *cdev, unsigned flag)
 	if (!cdev->putc)
 		flag &= ~(CONSOLE_STDOUT | CONSOLE_STDERR);
 
-	if (!flag && cdev->f_active && cdev->flush)
-		cdev->flush(cdev);
+	if (!flag && cdev->f_active)
+		console_flush_one(cdev);
 
 	if (flag == cdev->f_active)
 		return 0;
@@ -181,6 +332,8 @@ int console_set_baudrate(struct console_device *cdev, unsigned baudrate)
 		mdelay(50);
 	}
 
+	console_tx_drain(cdev);
+
 	ret = cdev->setbrg(cdev, baudrate);
 	if (ret)
 		return ret;
@@ -276,6 +429,9 @@ static int __console_puts(struct console_device *cdev, const char *s,
 {
 	size_t i;
 
+	if (cdev->tx_fifo)
+		return console_tx_puts(cdev, s, nbytes);
+
 	for (i = 0; i < nbytes; i++) {
 		if (*s == '\n') {
 			cdev->putc(cdev, '\r');
@@ -310,8 +466,7 @@ static int fops_flush(struct cdev *dev)
 {
 	struct console_device *priv = dev->priv;
 
-	if (priv->flush)
-		priv->flush(priv);
+	console_flush_one(priv);
 
 	return 0;
 }
@@ -385,6 +540,8 @@ int console_register(struct console_device *newcdev)
 
 	newcdev->baudrate = baudrate;
 
+	console_tx_init(newcdev);
+
 	if (newcdev->putc && !newcdev->puts)
 		newcdev->puts = __console_puts;
 
@@ -444,6 +601,8 @@ int console_unregister(struct console_device *cdev)
 
 	devfs_remove(&cdev->devfs);
 
+	console_tx_exit(cdev);
+
 	list_del(&cdev->list);
 	if (list_empty(&console_list))
 		initialized = CONSOLE_UNINITIALIZED;
@@ -498,6 +657,7 @@ static int getc_raw(void)
 				int ch = cdev->getc(cdev);
 
 				if (IS_ENABLED(CONFIG_RATP) && ch == 0x01) {
+					console_tx_drain(cdev);
 					barebox_ratp(cdev);
 					return -1;
 				}
@@ -587,11 +747,17 @@ void console_putc(unsigned int ch, char c)
 
 	case CONSOLE_INIT_FULL:
 		for_each_console(cdev) {
-			if (cdev->f_active & ch) {
-				if (c == '\n')
-					cdev->putc(cdev, '\r');
-				cdev->putc(cdev, c);
+			if (!(cdev->f_active & ch))
+				continue;
+
+			if (cdev->tx_fifo) {
+				console_tx_puts(cdev, &c, 1);
+				continue;
 			}
+
+			if (c == '\n')
+				cdev->putc(cdev, '\r');
+			cdev->putc(cdev, c);
 		}
 		return;
 	default:
@@ -634,10 +800,8 @@ void console_flush(void)
 {
 	struct console_device *cdev;
 
-	for_each_console(cdev) {
-		if (cdev->flush)
-			cdev->flush(cdev);
-	}
+	for_each_console(cdev)
+		console_flush_one(cdev);
 }
 EXPORT_SYMBOL(console_flush);
 
@@ -41,8 +41,20 @@ LIST_HEAD(barebox_logbuf);
 static int barebox_logbuf_num_messages;
 static int barebox_log_max_messages;
 
+/*
+ * With CONFIG_CONSOLE_DEFER_LOG, messages less important than
+ * console_defer_loglevel are only put into the log buffer until
+ * log_release_deferred() is called.
+ */
+static int console_defer_loglevel = MSG_WARNING;
+static bool console_deferring = IS_ENABLED(CONFIG_CONSOLE_DEFER_LOG);
+static unsigned int console_deferred_dropped;
+
 static void log_del(struct log_entry *log)
 {
+	if (log->deferred)
+		console_deferred_dropped++;
+
 	list_del(&log->list);
 	free(log);
 	barebox_logbuf_num_messages--;
@@ -83,10 +95,55 @@ static void print_colored_log_level(unsigned int ch, const int level)
 	console_puts(ch, colored_log_level[level]);
 }
 
-static void pr_puts(int level, const char *str)
+static bool log_defer(struct log_entry *log)
+{
+	if (!console_deferring || log->level <= console_defer_loglevel)
+		return false;
+
+	log->deferred = true;
+
+	return true;
+}
+
+#ifdef CONFIG_CONSOLE_DEFER_LOG
+/**
+ * log_release_deferred - print the log messages deferred so far
+ *
+ * Called when barebox drops to the shell or menu instead of booting.
+ * Messages logged afterwards are printed right away again.
+ */
+void log_release_deferred(void)
 {
 	struct log_entry *log;
 
+	if (!console_deferring)
+		return;
+
+	console_deferring = false;
+
+	if (console_deferred_dropped)
+		printf("%u deferred log messages were dropped\n",
+		       console_deferred_dropped);
+
+	list_for_each_entry(log, &barebox_logbuf, list) {
+		if (!log->deferred)
+			continue;
+
+		log->deferred = false;
+
+		if (log->level > barebox_loglevel)
+			continue;
+
+		print_colored_log_level(CONSOLE_STDERR, log->level);
+		console_puts(CONSOLE_STDERR, log->msg);
+	}
+}
+#endif
+
+static void pr_puts(int level, const char *str)
+{
+	struct log_entry *log = NULL;
+
 	if (IS_ENABLED(CONFIG_LOGBUF) && mem_malloc_is_initialized()) {
 		if (barebox_log_max_messages > 0)
 			log_clean(barebox_log_max_messages - 1);
@@ -103,6 +160,7 @@ static void pr_puts(int level, const char *str)
 
 			log->timestamp = get_time_ns();
 			log->level = level;
+			log->deferred = false;
 			list_add_tail(&log->list, &barebox_logbuf);
 			barebox_logbuf_num_messages++;
 		}
@@ -114,6 +172,9 @@ static void pr_puts(int level, const char *str)
 	if (level > barebox_loglevel)
 		return;
 
+	if (log && log_defer(log))
+		return;
+
 	print_colored_log_level(CONSOLE_STDERR, level);
 	console_puts(CONSOLE_STDERR, str);
 }
@@ -182,12 +243,21 @@ static int console_common_init(void)
 				&barebox_log_max_messages, "%d");
 	}
 
+	if (IS_ENABLED(CONFIG_CONSOLE_DEFER_LOG))
+		globalvar_add_simple_int("console.defer_loglevel",
+				&console_defer_loglevel, "%d");
+
 	globalvar_add_simple_bool("allow_color", &__console_allow_color);
 
 	return globalvar_add_simple_int("loglevel", &barebox_loglevel, "%d");
 }
 core_initcall(console_common_init);
 
+#ifdef CONFIG_CONSOLE_DEFER_LOG
+BAREBOX_MAGICVAR(global.console.defer_loglevel,
+		 "Messages less important than this are only printed when barebox doesn't boot");
+#endif
+
 int log_writefile(const char *filepath)
 {
 	int ret = 0, nbytes = 0, fd = -1;
@@ -18,6 +18,30 @@
 #include <init.h>
 #include <string.h>
 #include <environment.h>
+#include <linux/hash.h>
+
+/*
+ * Variables of all contexts share one hash table, keyed by the list they
+ * live on and their name. The lists stay the authoritative storage and
+ * keep the insertion order for printenv and completion.
+ */
+#define ENV_HASH_BITS	8
+
+static struct hlist_head env_hash[1 << ENV_HASH_BITS];
+
+static struct hlist_head *env_hash_bucket(struct list_head *l, u32 hash)
+{
+	return &env_hash[hash_32(hash ^ (u32)(ulong)l, ENV_HASH_BITS)];
+}
+
+static void env_free_var(struct variable_d *v)
+{
+	hlist_del(&v->hash_node);
+	list_del(&v->list);
+	free(v->name);
+	free(v->data);
+	free(v);
+}
 
 static struct env_context root = {
 	.local = LIST_HEAD_INIT(root.local),
@@ -34,19 +58,11 @@ static void free_context(struct env_context *c)
 {
 	struct variable_d *v, *tmp;
 
-	list_for_each_entry_safe(v, tmp, &c->local, list) {
-		free(v->name);
-		free(v->data);
-		list_del(&v->list);
-		free(v);
-	}
+	list_for_each_entry_safe(v, tmp, &c->local, list)
+		env_free_var(v);
 
-	list_for_each_entry_safe(v, tmp, &c->global, list) {
-		free(v->name);
-		free(v->data);
-		list_del(&v->list);
-		free(v);
-	}
+	list_for_each_entry_safe(v, tmp, &c->global, list)
+		env_free_var(v);
 
 	free(c);
 }
@@ -111,18 +127,26 @@ char *var_name(struct variable_d *var)
 	return var->name;
 }
 
-static const char *getenv_raw(struct list_head *l, const char *name)
+static struct variable_d *env_find(struct list_head *l, const char *name,
+				    u32 hash)
 {
 	struct variable_d *v;
 
-	list_for_each_entry(v, l, list) {
-		if (!strcmp(var_name(v), name))
-			return var_val(v);
+	hlist_for_each_entry(v, env_hash_bucket(l, hash), hash_node) {
+		if (v->head == l && v->hash == hash && !strcmp(v->name, name))
+			return v;
 	}
 
 	return NULL;
 }
 
+static const char *getenv_raw(struct list_head *l, const char *name)
+{
+	struct variable_d *v = env_find(l, name, strhash(name));
+
+	return v ? var_val(v) : NULL;
+}
+
 static const char *dev_getenv(const char *name)
 {
 	const char *pos, *val, *dot, *varname;
@@ -158,21 +182,23 @@ static const char *dev_getenv(const char *name)
 const char *getenv(const char *name)
 {
 	struct env_context *c;
-	const char *val;
+	struct variable_d *v;
+	u32 hash;
 
 	if (strchr(name, '.'))
 		return dev_getenv(name);
 
 	c = context;
+	hash = strhash(name);
 
-	val = getenv_raw(&c->local, name);
-	if (val)
-		return val;
+	v = env_find(&c->local, name, hash);
+	if (v)
+		return var_val(v);
 
 	while (c) {
-		val = getenv_raw(&c->global, name);
-		if (val)
-			return val;
+		v = env_find(&c->global, name, hash);
+		if (v)
+			return var_val(v);
 		c = c->parent;
 	}
 	return NULL;
@@ -181,31 +207,29 @@ EXPORT_SYMBOL(getenv);
 
 static int setenv_raw(struct list_head *l, const char *name, const char *value)
 {
+	u32 hash = strhash(name);
 	struct variable_d *v;
 
-	list_for_each_entry(v, l, list) {
-		if (!strcmp(v->name, name)) {
-			if (value) {
-				free(v->data);
-				v->data = xstrdup(value);
-
-				return 0;
-			} else {
-				list_del(&v->list);
-				free(v->name);
-				free(v->data);
-				free(v);
-
-				return 0;
-			}
+	v = env_find(l, name, hash);
+	if (v) {
+		if (value) {
+			free(v->data);
+			v->data = xstrdup(value);
+		} else {
+			env_free_var(v);
 		}
+
+		return 0;
 	}
 
 	if (value) {
 		v = xzalloc(sizeof(*v));
 		v->name = xstrdup(name);
 		v->data = xstrdup(value);
+		v->head = l;
+		v->hash = hash;
 		list_add_tail(&v->list, l);
+		hlist_add_head(&v->hash_node, env_hash_bucket(l, hash));
 	}
 
 	return 0;
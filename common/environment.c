@@ -29,6 +29,8 @@
 #include <block.h>
 #include <efi/partition.h>
 #include <bootsource.h>
+#include <ioctl.h>
+#include <linux/mtd/mtd-abi.h>
 #else
 #define EXPORT_SYMBOL(x)
 #endif
@@ -145,6 +147,63 @@ static int do_compare_file(const char *filename, const char *base)
 	return ret;
 }
 
+/*
+ * envfs_write_changed - write only the eraseblocks which have changed
+ *
+ * Saving the environment to NOR flash used to erase and program the
+ * whole partition, even if only a single variable changed. On flashes
+ * which can erase and program individual eraseblocks, compare the new
+ * environment with the one currently stored and only rewrite the
+ * eraseblocks that differ.
+ *
+ * @return: 0 on success, -EOPNOTSUPP if the device doesn't support
+ * differential writes, other negative error code otherwise. Errors are
+ * not reported here, that's left to the caller.
+ */
+static int envfs_write_changed(int fd, const void *buf, size_t size)
+{
+	struct mtd_info_user meminfo;
+	size_t ofs, now, chunk;
+	void *old;
+	int ret;
+
+	if (ioctl(fd, MEMGETINFO, &meminfo) || !meminfo.erasesize)
+		return -EOPNOTSUPP;
+
+	/*
+	 * NAND environments are written through the bad block aware
+	 * device which can only be written sequentially from the start.
+	 */
+	if (meminfo.type == MTD_NANDFLASH || meminfo.type == MTD_MLCNANDFLASH)
+		return -EOPNOTSUPP;
+
+	chunk = meminfo.erasesize;
+	old = xmalloc(chunk);
+
+	for (ofs = 0; ofs < size; ofs += chunk) {
+		now = min(chunk, size - ofs);
+
+		ret = pread_full(fd, old, now, ofs);
+		if (ret == now && !memcmp(old, buf + ofs, now))
+			continue;
+
+		pr_debug("rewriting eraseblock at 0x%zx\n", ofs);
+
+		ret = erase(fd, chunk, ofs, ERASE_TO_WRITE);
+		if (ret && errno != ENOSYS && errno != EOPNOTSUPP)
+			goto out;
+
+		ret = pwrite_full(fd, buf + ofs, now, ofs);
+		if (ret < 0)
+			goto out;
+	}
+
+	ret = 0;
+out:
+	free(old);
+
+	return ret;
+}
 #else
 #define ERASE_SIZE_ALL 0
 static inline int protect(int fd, size_t count, unsigned long offset, int prot)
@@ -164,6 +223,11 @@ static int do_compare_file(const char *filename, const char *base)
 {
 	return 1;
 }
+
+static int envfs_write_changed(int fd, const void *buf, size_t size)
+{
+	return -EOPNOTSUPP;
+}
 #endif
 
 static int file_action(const char *filename, struct stat *statbuf,
@@ -383,27 +447,35 @@ int envfs_save(const char *filename, const char *dirname, unsigned flags)
 		goto out;
 	}
 
-	ret = erase(envfd, ERASE_SIZE_ALL, 0, ERASE_TO_WRITE);
+	size += sizeof(struct envfs_super);
 
-	/* ENOSYS and EOPNOTSUPP aren't errors here, many devices don't need it */
-	if (ret && errno != ENOSYS && errno != EOPNOTSUPP) {
-		printf("could not erase %s: %m\n", filename);
+	ret = envfs_write_changed(envfd, buf, size);
+	if (ret && ret != -EOPNOTSUPP) {
+		printf("could not write %s: %s\n", filename, strerror(-ret));
 		goto out;
 	}
 
-	size += sizeof(struct envfs_super);
+	if (ret == -EOPNOTSUPP) {
+		ret = erase(envfd, ERASE_SIZE_ALL, 0, ERASE_TO_WRITE);
 
-	wbuf = buf;
-
-	while (size) {
-		ssize_t now = write(envfd, wbuf, size);
-		if (now < 0) {
-			ret = -errno;
+		/* ENOSYS and EOPNOTSUPP aren't errors here, many devices don't need it */
+		if (ret && errno != ENOSYS && errno != EOPNOTSUPP) {
+			printf("could not erase %s: %m\n", filename);
 			goto out;
 		}
 
-		wbuf += now;
-		size -= now;
+		wbuf = buf;
+
+		while (size) {
+			ssize_t now = write(envfd, wbuf, size);
+			if (now < 0) {
+				ret = -errno;
+				goto out;
+			}
+
+			wbuf += now;
+			size -= now;
+		}
 	}
 
 	ret = protect(envfd, ~0, 0, 1);
@@ -117,6 +117,7 @@
 #include <binfmt.h>
 #include <init.h>
 #include <shell.h>
+#include <clock.h>
 
 /*cmd_boot.c*/
 extern int do_bootd(int flag, int argc, char *argv[]);      /* do_bootd */
@@ -192,6 +193,8 @@ struct p_context {
 
 	int options_parsed;
 	struct list_head options;
+
+	struct hush_script *script;	/* script cache entry being recorded */
 };
 
 
@@ -323,9 +326,15 @@ static int parse_string_outer(struct p_context *ctx, const char *s, int flag);
 /*     local variable support */
 static char **make_list_in(char **inp, char *name);
 static char *insert_var_value(char *inp);
+static char *__insert_var_value(char *inp, bool *plain);
 static int set_local_var(const char *s, int flg_export);
 static int execute_script(const char *path, int argc, char *argv[]);
 static int source_script(const char *path, int argc, char *argv[]);
+/*     script cache */
+static void hush_script_uses_args(struct p_context *ctx);
+static void hush_script_uncacheable(struct p_context *ctx);
+static int hush_script_record(struct p_context *ctx, struct pipe *pi);
+static void hush_script_record_done(struct p_context *ctx);
 
 static int b_check_space(o_string *o, int len)
 {
@@ -727,6 +736,49 @@ static void do_glob_in_argv(glob_t *globbuf, int argc, char **argv)
 	}
 }
 
+static void free_argv(char **argv)
+{
+	char **p;
+
+	if (!argv)
+		return;
+
+	for (p = argv; *p; p++)
+		free(*p);
+
+	free(argv);
+}
+
+/*
+ * Substitute the variables in the words of a command directly. This is
+ * what joining the substituted words and parsing them again results in,
+ * as long as no value contains something the parser acts upon, like
+ * whitespace, quotes, backslashes or comments, no word turns empty and
+ * the command doesn't turn into an assignment. Returns NULL if the
+ * command has to be parsed again.
+ */
+static char **expand_argv(int argc, char **argv)
+{
+	char **res = xzalloc((argc + 1) * sizeof(*res));
+	bool plain = true;
+	char *p;
+	int i;
+
+	for (i = 0; i < argc && plain; i++) {
+		p = __insert_var_value(argv[i], &plain);
+		res[i] = p == argv[i] ? xstrdup(p) : p;
+		if (!*res[i])
+			plain = false;
+	}
+
+	if (plain && !is_assignment(res[0]))
+		return res;
+
+	free_argv(res);
+
+	return NULL;
+}
+
 /* run_pipe_real() starts all the jobs, but doesn't wait for anything
  * to finish.  See checkjobs().
  *
@@ -749,9 +801,11 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	int nextin;
 	struct child_prog *child;
 	char *p;
+	char **argv, **expanded = NULL;
 	glob_t globbuf = {};
 	int ret;
 	int rcode;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -780,6 +834,9 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	if (!pi->progs[0].argv)
 		return -1;
 
+	/* the pipe may be run again from the script cache, don't modify it */
+	sp = child->sp;
+
 	for (i = 0; is_assignment(child->argv[i]); i++)
 		{ /* nothing */ }
 
@@ -814,13 +871,22 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 			return 1;
 
 		if (p != child->argv[i]) {
-			child->sp--;
+			sp--;
 			free(p);
 		}
 	}
-	if (child->sp) {
+
+	argv = &child->argv[i];
+
+	if (sp) {
+		expanded = expand_argv(child->argc - i, argv);
+		if (expanded)
+			argv = expanded;
+	}
+
+	if (sp && !expanded) {
 		char * str = NULL;
-		struct p_context ctx1;
+		struct p_context ctx1 = {};
 
 		initialize_context(&ctx1);
 
@@ -832,7 +898,7 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 		return rcode;
 	}
 
-	do_glob_in_argv(&globbuf, child->argc - i, &child->argv[i]);
+	do_glob_in_argv(&globbuf, child->argc - i, argv);
 
 	remove_quotes(globbuf.gl_pathc, globbuf.gl_pathv);
 
@@ -850,15 +916,32 @@ static int run_pipe_real(struct p_context *ctx, struct pipe *pi)
 	}
 
 	globfree(&globbuf);
+	free_argv(expanded);
 
 	return ret;
 }
 
+static void free_list_in(char **save_list, char **list, char **for_argv)
+{
+	free(for_argv[0]);
+	for_argv[0] = NULL;
+
+	if (!save_list)
+		return;
+
+	while (*list)
+		free(*list++);
+
+	free(save_list);
+}
+
 static int run_list_real(struct p_context *ctx, struct pipe *pi)
 {
-	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	char *for_argv[2] = {};
+	struct child_prog for_child;
+	struct pipe for_pipe, *run_pi;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 	int rcode=0, flag_skip=1;
@@ -887,8 +970,10 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 		if (pi->r_mode == RES_WHILE || pi->r_mode == RES_UNTIL ||
 				pi->r_mode == RES_FOR) {
 			/* check Ctrl-C */
-			if (ctrlc())
+			if (ctrlc()) {
+				free_list_in(save_list, list, for_argv);
 				return 1;
+			}
 			flag_restore = 0;
 			if (!rpipe) {
 				flag_rep = 0;
@@ -896,6 +981,7 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 			}
 		}
 		rmode = pi->r_mode;
+		run_pi = pi;
 		hush_debug("rmode=%d  if_code=%d  next_if_code=%d skip_more=%d\n",
 				rmode, if_code, next_if_code, skip_more_in_this_rmode);
 		if (rmode == skip_more_in_this_rmode && flag_skip) {
@@ -929,23 +1015,27 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 				list = make_list_in(pi->next->progs->argv,
 					pi->progs->argv[0]);
 				save_list = list;
-				save_name = pi->progs->argv[0];
-				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
 			}
+			free(for_argv[0]);
+			for_argv[0] = NULL;
 			if (!(*list)) {
-				free(pi->progs->argv[0]);
 				free(save_list);
-				list = NULL;
+				save_list = list = NULL;
 				flag_rep = 0;
-				pi->progs->argv[0] = save_name;
 				continue;
-			} else {
-				/* insert new value from list for variable */
-				if (pi->progs->argv[0])
-					free(pi->progs->argv[0]);
-				pi->progs->argv[0] = *list++;
 			}
+			/*
+			 * Assign the next value through a copy of the pipe,
+			 * the parsed one may be run again from the script cache
+			 */
+			for_argv[0] = *list++;
+			for_child = pi->progs[0];
+			for_child.argv = for_argv;
+			for_child.argc = 1;
+			for_pipe = *pi;
+			for_pipe.progs = &for_child;
+			run_pi = &for_pipe;
 		}
 		if (rmode == RES_IN)
 			continue;
@@ -966,11 +1056,12 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 		if (pi->num_progs == 0)
 			continue;
 
-		rcode = run_pipe_real(ctx, pi);
+		rcode = run_pipe_real(ctx, run_pi);
 		hush_debug("run_pipe_real returned %d\n",rcode);
 
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
+			free_list_in(save_list, list, for_argv);
 			return rcode;	/* exit */
 		}
 
@@ -1004,6 +1095,8 @@ static int run_list_real(struct p_context *ctx, struct pipe *pi)
 			skip_more_in_this_rmode = rmode;
 	}
 
+	free_list_in(save_list, list, for_argv);
+
 	/* Substitute exit code in case flag_conditional is set. */
 	if (flag_conditional == 1 && last_return_code == 1) {
 		last_return_code = 0;
@@ -1313,6 +1406,10 @@ static int done_word(o_string *dest, struct p_context *ctx)
 	if (child->argv)
 		flags |= GLOB_APPEND;
 
+	/* globbed while parsing, the result must not be cached */
+	if (ctx->w == RES_IN && dest->data && strpbrk(dest->data, "*?["))
+		hush_script_uncacheable(ctx);
+
 	gr = xglob(dest, flags, glob_target, ctx->w == RES_IN ? 1 : 0);
 	if (gr)
 		return 1;
@@ -1448,6 +1545,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 
 	} else if (isdigit(ch)) {
 
+		hush_script_uses_args(ctx);
 		i = ch - '0';	/* XXX is $0 special? */
 		if (i < ctx->global_argc) {
 			parse_string(dest, ctx, ctx->global_argv[i]);        /* recursion */
@@ -1464,6 +1562,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 			advance = 1;
 			break;
 		case '#':
+			hush_script_uses_args(ctx);
 			b_adduint(dest,ctx->global_argc ? ctx->global_argc-1 : 0);
 			advance = 1;
 			break;
@@ -1484,6 +1583,7 @@ static int handle_dollar(o_string *dest, struct p_context *ctx, struct in_str *i
 			b_addchr(dest, SPECIAL_VAR_SYMBOL);
 			break;
 		case '*':
+			hush_script_uses_args(ctx);
 			for (i = 1; i < ctx->global_argc; i++) {
 				b_addstr(dest, ctx->global_argv[i]);
 				b_addchr(dest, ' ');
@@ -1731,7 +1831,10 @@ static int parse_stream_outer(struct p_context *ctx, struct in_str *inp, int fla
 			done_word(&temp, ctx);
 			done_pipe(ctx, PIPE_SEQ);
 			if (ctx->list_head->num_progs) {
-				code = run_list(ctx, ctx->list_head);
+				if (ctx->script)
+					code = hush_script_record(ctx, ctx->list_head);
+				else
+					code = run_list(ctx, ctx->list_head);
 			} else {
 				free_pipe_list(ctx->list_head, 0);
 				continue;
@@ -1756,6 +1859,9 @@ static int parse_stream_outer(struct p_context *ctx, struct in_str *inp, int fla
 		b_free(&temp);
 	} while (!ctrlc() && rcode != -1 && !(flag & FLAG_EXIT_FROM_LOOP));   /* loop on syntax errors, return on EOF */
 
+	if (rcode == -1)
+		hush_script_record_done(ctx);
+
 	return code;
 }
 
@@ -1785,7 +1891,12 @@ static int parse_string_outer(struct p_context *ctx, const char *s, int flag)
 	return rcode;
 }
 
-static char *insert_var_value(char *inp)
+/*
+ * Substitute the variables marked with SPECIAL_VAR_SYMBOL in @inp. If
+ * @plain is given, it is cleared when a value contains characters that
+ * are special to the parser.
+ */
+static char *__insert_var_value(char *inp, bool *plain)
 {
 	int res_str_len = 0;
 	int len;
@@ -1804,6 +1915,8 @@ static char *insert_var_value(char *inp)
 		p = strchr(inp, SPECIAL_VAR_SYMBOL);
 		*p = '\0';
 		if ((p1 = lookup_param(inp))) {
+			if (plain && strpbrk(p1, " \t\n\\'\"#"))
+				*plain = false;
 			len = res_str_len + strlen(p1);
 			res_str = xrealloc(res_str, (1 + len));
 			strcpy((res_str + res_str_len), p1);
@@ -1823,6 +1936,11 @@ static char *insert_var_value(char *inp)
 	return (res_str == NULL) ? inp : res_str;
 }
 
+static char *insert_var_value(char *inp)
+{
+	return __insert_var_value(inp, NULL);
+}
+
 static char **make_list_in(char **inp, char *name)
 {
 	int len, i;
@@ -1904,6 +2022,312 @@ int run_command(const char *cmd)
 	return ret;
 }
 
+#ifdef CONFIG_HUSH_SCRIPT_CACHE
+/*
+ * Script cache
+ *
+ * While a script runs for the first time, the pipe lists
+ * parse_stream_outer() parsed are kept instead of being freed after they
+ * ran. If the script ran up to its end, later runs of the unchanged script
+ * run the kept lists directly without reading them through the parser
+ * again. The barebox filesystems don't maintain modification times, so a
+ * script counts as unchanged when its contents match the ones the lists
+ * were parsed from. Positional parameters are substituted while parsing,
+ * so for scripts using them the parameters have to match as well. Scripts
+ * globbing in for loops while being parsed are not cached at all.
+ */
+#define HUSH_SCRIPT_CACHE_MAX	32
+
+struct hush_script {
+	struct list_head list;
+	char *path;
+
+	/* parse result, valid when pipes is set */
+	struct pipe **pipes;
+	unsigned int num_pipes;
+	char *text;
+	size_t size;
+	char **argv;
+	int argc;
+	u64 last_used;
+
+	bool recording;
+	bool complete;
+	bool uses_args;
+	bool uncacheable;
+	unsigned int users;
+
+	unsigned int runs;
+	unsigned int cached_runs;
+	u64 time_ns;
+	u64 max_ns;
+};
+
+static LIST_HEAD(hush_scripts);
+static u64 hush_script_seq;
+
+static void hush_script_uses_args(struct p_context *ctx)
+{
+	if (ctx->script)
+		ctx->script->uses_args = true;
+}
+
+static void hush_script_uncacheable(struct p_context *ctx)
+{
+	if (ctx->script)
+		ctx->script->uncacheable = true;
+}
+
+static int hush_script_record(struct p_context *ctx, struct pipe *pi)
+{
+	struct hush_script *s = ctx->script;
+
+	s->pipes = xrealloc(s->pipes, (s->num_pipes + 1) * sizeof(*s->pipes));
+	s->pipes[s->num_pipes++] = pi;
+
+	return run_list_real(ctx, pi);
+}
+
+static void hush_script_record_done(struct p_context *ctx)
+{
+	if (ctx->script)
+		ctx->script->complete = true;
+}
+
+static void hush_script_drop(struct hush_script *s)
+{
+	unsigned int i;
+	int a;
+
+	for (i = 0; i < s->num_pipes; i++)
+		free_pipe_list(s->pipes[i], 0);
+
+	for (a = 0; a < s->argc; a++)
+		free(s->argv[a]);
+
+	free(s->pipes);
+	free(s->text);
+	free(s->argv);
+
+	s->pipes = NULL;
+	s->num_pipes = 0;
+	s->text = NULL;
+	s->argv = NULL;
+	s->argc = 0;
+}
+
+static struct hush_script *hush_script_get(const char *path)
+{
+	struct hush_script *s;
+
+	list_for_each_entry(s, &hush_scripts, list)
+		if (!strcmp(s->path, path))
+			return s;
+
+	s = xzalloc(sizeof(*s));
+	s->path = xstrdup(path);
+	list_add_tail(&s->list, &hush_scripts);
+
+	return s;
+}
+
+static bool hush_script_valid(struct hush_script *s, const char *text,
+			      size_t size, int argc, char *argv[])
+{
+	int i;
+
+	if (!s->pipes || s->size != size || memcmp(s->text, text, size))
+		return false;
+
+	if (!s->uses_args)
+		return true;
+
+	if (s->argc != argc)
+		return false;
+
+	for (i = 0; i < argc; i++)
+		if (strcmp(s->argv[i], argv[i]))
+			return false;
+
+	return true;
+}
+
+static void hush_script_evict(void)
+{
+	struct hush_script *s, *lru;
+	unsigned int cached;
+
+	do {
+		lru = NULL;
+		cached = 0;
+
+		list_for_each_entry(s, &hush_scripts, list) {
+			if (!s->pipes)
+				continue;
+			cached++;
+			if (!s->users && (!lru || s->last_used < lru->last_used))
+				lru = s;
+		}
+
+		if (cached <= HUSH_SCRIPT_CACHE_MAX || !lru)
+			return;
+
+		hush_script_drop(lru);
+	} while (1);
+}
+
+static int hush_script_replay(struct p_context *ctx, struct hush_script *s)
+{
+	unsigned int i;
+	int code = 0;
+
+	s->users++;
+
+	for (i = 0; i < s->num_pipes; i++) {
+		/* like parse_stream_outer() does for each list */
+		release_context(ctx);
+		ctx->options_parsed = 0;
+		INIT_LIST_HEAD(&ctx->options);
+
+		code = run_list_real(ctx, s->pipes[i]);
+		if (code < -1 || ctrlc())
+			break;
+	}
+
+	s->users--;
+
+	return code;
+}
+
+static int hush_script_exec(struct p_context *ctx, const char *path,
+			    char **script, size_t size)
+{
+	struct hush_script *s = hush_script_get(path);
+	u64 start = get_time_ns(), ns;
+	int argc = ctx->global_argc;
+	char **argv = ctx->global_argv;
+	int ret, i;
+
+	s->last_used = ++hush_script_seq;
+
+	if (hush_script_valid(s, *script, size, argc, argv)) {
+		ret = hush_script_replay(ctx, s);
+		s->cached_runs++;
+		goto out;
+	}
+
+	/* don't pull the lists away from under a running instance */
+	if (s->users) {
+		ret = parse_string_outer(ctx, *script, FLAG_PARSE_SEMICOLON);
+		goto out;
+	}
+
+	hush_script_drop(s);
+	s->complete = s->uses_args = s->uncacheable = false;
+	s->users++;
+	ctx->script = s;
+
+	ret = parse_string_outer(ctx, *script, FLAG_PARSE_SEMICOLON);
+
+	ctx->script = NULL;
+	s->users--;
+
+	if (!s->complete || s->uncacheable) {
+		hush_script_drop(s);
+		goto out;
+	}
+
+	s->text = *script;
+	s->size = size;
+	*script = NULL;
+
+	if (s->uses_args) {
+		s->argc = argc;
+		s->argv = xmalloc(argc * sizeof(*s->argv));
+		for (i = 0; i < argc; i++)
+			s->argv[i] = xstrdup(argv[i]);
+	}
+
+	hush_script_evict();
+out:
+	ns = get_time_ns() - start;
+	s->runs++;
+	s->time_ns += ns;
+	s->max_ns = max(s->max_ns, ns);
+
+	return ret;
+}
+
+static int do_shstat(int argc, char *argv[])
+{
+	struct hush_script *s;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f")) > 0) {
+		switch (opt) {
+		case 'f':
+			list_for_each_entry(s, &hush_scripts, list)
+				if (!s->users)
+					hush_script_drop(s);
+			return 0;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	printf("%10s %10s %6s %6s %7s  %s\n", "total us", "max us", "runs",
+	       "cached", "lists", "script");
+
+	list_for_each_entry(s, &hush_scripts, list)
+		printf("%10llu %10llu %6u %6u %7u  %s\n", s->time_ns / 1000,
+		       s->max_ns / 1000, s->runs, s->cached_runs,
+		       s->num_pipes, s->path);
+
+	return 0;
+}
+
+BAREBOX_CMD_HELP_START(shstat)
+BAREBOX_CMD_HELP_TEXT("List the scripts run so far with their accumulated and maximum")
+BAREBOX_CMD_HELP_TEXT("execution time, including the scripts they called, how often they")
+BAREBOX_CMD_HELP_TEXT("ran, how often of that from the script cache, and the number of")
+BAREBOX_CMD_HELP_TEXT("parsed lists kept in the cache.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT("-f", "flush the script cache")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(shstat)
+	.cmd		= do_shstat,
+	BAREBOX_CMD_DESC("show script execution times and cache state")
+	BAREBOX_CMD_OPTS("[-f]")
+	BAREBOX_CMD_GROUP(CMD_GRP_SCRIPT)
+	BAREBOX_CMD_HELP(cmd_shstat_help)
+BAREBOX_CMD_END
+#else
+static void hush_script_uses_args(struct p_context *ctx)
+{
+}
+
+static void hush_script_uncacheable(struct p_context *ctx)
+{
+}
+
+static int hush_script_record(struct p_context *ctx, struct pipe *pi)
+{
+	return run_list(ctx, pi);
+}
+
+static void hush_script_record_done(struct p_context *ctx)
+{
+}
+
+static int hush_script_exec(struct p_context *ctx, const char *path,
+			    char **script, size_t size)
+{
+	return parse_string_outer(ctx, *script, FLAG_PARSE_SEMICOLON);
+}
+#endif
+
 static int execute_script(const char *path, int argc, char *argv[])
 {
 	int ret;
@@ -1919,6 +2343,7 @@ static int source_script(const char *path, int argc, char *argv[])
 {
 	struct p_context ctx = {};
 	char *script;
+	size_t size;
 	int ret;
 
 	initialize_context(&ctx);
@@ -1926,13 +2351,13 @@ static int source_script(const char *path, int argc, char *argv[])
 	ctx.global_argc = argc;
 	ctx.global_argv = argv;
 
-	script = read_file(path, NULL);
+	script = read_file(path, &size);
 	if (!script) {
 		perror("sh");
 		return 1;
 	}
 
-	ret = parse_string_outer(&ctx, script, FLAG_PARSE_SEMICOLON);
+	ret = hush_script_exec(&ctx, path, &script, size);
 	if (ret < -1)
 		ret = -ret - 2;
 
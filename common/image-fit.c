@@ -23,6 +23,7 @@
 #include <crypto/public_key.h>
 #include <uncompress.h>
 #include <image-fit.h>
+#include <boottrace.h>
 
 #define FDT_MAX_DEPTH 32
 #define FDT_MAX_PATH_LEN 200
@@ -636,6 +637,7 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 	const char *unit = name, *type = NULL, *desc= "(no description)";
 	const void *data;
 	int data_len;
+	u64 start;
 	int ret = 0;
 
 	ret = fit_get_image(handle, configuration, &unit, &image);
@@ -657,15 +659,24 @@ int fit_open_image(struct fit_handle *handle, void *configuration,
 		return -EINVAL;
 	}
 
+	start = boottrace_start();
+
 	if (configuration)
 		ret = fit_verify_hash(handle, image, data, data_len);
 	else
 		ret = fit_image_verify_signature(handle, image, data, data_len);
 
+	boottrace_record("bootm", start, "verify %s", unit);
+
 	if (ret < 0)
 		return ret;
 
+	start = boottrace_start();
+
 	ret = fit_handle_decompression(image, type, &data, &data_len);
+
+	boottrace_record("bootm", start, "decompress %s", unit);
+
 	if (ret)
 		return ret;
 
@@ -918,14 +929,25 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 	handle->verbose = verbose;
 	handle->verify = verify;
 
-	ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
-			  max_size);
+	/*
+	 * Work directly on memory mapped images unless signatures are
+	 * checked: The data could be modified behind our back between
+	 * verifying and using it, so copy it to private memory in that case.
+	 */
+	if (verify >= BOOTM_VERIFY_SIGNATURE)
+		ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
+				  max_size);
+	else
+		ret = read_file_mapped(filename, &handle->size, &handle->fit,
+				       &handle->fit_alloc, max_size);
 	if (ret && ret != -EFBIG) {
 		pr_err("unable to read %s: %s\n", filename, strerror(-ret));
+		free(handle);
 		return ERR_PTR(ret);
 	}
 
-	handle->fit = handle->fit_alloc;
+	if (handle->fit_alloc)
+		handle->fit = handle->fit_alloc;
 
 	ret = fit_do_open(handle);
 	if (ret) {
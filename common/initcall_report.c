@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * initcall_report.c - time spent per initcall and per driver registration
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <initcall_report.h>
+#include <malloc.h>
+#include <qsort.h>
+#include <stdio.h>
+
+struct initcall_stat {
+	initcall_t fn;
+	u64 ns;
+	bool skipped;
+};
+
+struct driver_stat {
+	const char *name;
+	u64 ns;
+	unsigned int tried;
+};
+
+static struct initcall_stat *initcall_stats;
+static unsigned int initcall_num, initcall_alloc;
+static bool initcall_skip_pending;
+
+static struct driver_stat *driver_stats;
+static unsigned int driver_num, driver_alloc;
+
+void initcall_report_record(initcall_t fn, u64 start)
+{
+	struct initcall_stat *s;
+
+	if (initcall_num == initcall_alloc) {
+		initcall_alloc = initcall_alloc ? initcall_alloc * 2 : 256;
+		initcall_stats = xrealloc(initcall_stats,
+				initcall_alloc * sizeof(*initcall_stats));
+	}
+
+	s = &initcall_stats[initcall_num++];
+	s->fn = fn;
+	s->ns = get_time_ns() - start;
+	s->skipped = initcall_skip_pending;
+
+	initcall_skip_pending = false;
+}
+
+/*
+ * Called by machine initcall guards when the running machine doesn't
+ * match, see __define_machine_initcall()
+ */
+void initcall_report_skipped(void)
+{
+	initcall_skip_pending = true;
+}
+
+void driver_report_record(struct driver *drv, u64 start, unsigned int tried)
+{
+	struct driver_stat *s;
+
+	if (driver_num == driver_alloc) {
+		driver_alloc = driver_alloc ? driver_alloc * 2 : 256;
+		driver_stats = xrealloc(driver_stats,
+				driver_alloc * sizeof(*driver_stats));
+	}
+
+	s = &driver_stats[driver_num++];
+	s->name = drv->name;
+	s->ns = get_time_ns() - start;
+	s->tried = tried;
+}
+
+static int initcall_stat_cmp(const void *a, const void *b)
+{
+	const struct initcall_stat *sa = a, *sb = b;
+
+	return sa->ns < sb->ns ? 1 : sa->ns > sb->ns ? -1 : 0;
+}
+
+static int driver_stat_cmp(const void *a, const void *b)
+{
+	const struct driver_stat *sa = a, *sb = b;
+
+	return sa->ns < sb->ns ? 1 : sa->ns > sb->ns ? -1 : 0;
+}
+
+static void initcall_report_print_initcalls(unsigned int max)
+{
+	struct initcall_stat *sorted;
+	unsigned int i, skipped = 0;
+	u64 total = 0, skipped_ns = 0;
+
+	for (i = 0; i < initcall_num; i++) {
+		total += initcall_stats[i].ns;
+		if (initcall_stats[i].skipped) {
+			skipped++;
+			skipped_ns += initcall_stats[i].ns;
+		}
+	}
+
+	printf("%u initcalls, %llu us total, %u skipped by machine guards (%llu us)\n",
+	       initcall_num, total / 1000, skipped, skipped_ns / 1000);
+
+	sorted = xmemdup(initcall_stats, initcall_num * sizeof(*sorted));
+	qsort(sorted, initcall_num, sizeof(*sorted), initcall_stat_cmp);
+
+	printf("%10s  %s\n", "us", "initcall");
+	for (i = 0; i < initcall_num && (!max || i < max); i++)
+		printf("%10llu  %pS%s\n", sorted[i].ns / 1000, sorted[i].fn,
+		       sorted[i].skipped ? " (skipped)" : "");
+
+	free(sorted);
+}
+
+static void initcall_report_print_drivers(unsigned int max)
+{
+	struct driver_stat *sorted;
+	unsigned int i, tried = 0;
+	u64 total = 0;
+
+	for (i = 0; i < driver_num; i++) {
+		total += driver_stats[i].ns;
+		tried += driver_stats[i].tried;
+	}
+
+	printf("%u driver registrations, %llu us total including probes, "
+	       "%u devices matched against\n", driver_num, total / 1000, tried);
+
+	sorted = xmemdup(driver_stats, driver_num * sizeof(*sorted));
+	qsort(sorted, driver_num, sizeof(*sorted), driver_stat_cmp);
+
+	printf("%10s %8s  %s\n", "us", "devices", "driver");
+	for (i = 0; i < driver_num && (!max || i < max); i++)
+		printf("%10llu %8u  %s\n", sorted[i].ns / 1000,
+		       sorted[i].tried, sorted[i].name);
+
+	free(sorted);
+}
+
+/**
+ * initcall_report_print - print the most expensive initcalls or drivers
+ * @max: number of entries to print, 0 for all
+ * @drivers: print driver registrations instead of initcalls
+ */
+void initcall_report_print(unsigned int max, bool drivers)
+{
+	if (drivers)
+		initcall_report_print_drivers(max);
+	else
+		initcall_report_print_initcalls(max);
+}
@@ -15,6 +15,9 @@ extern const u16 kallsyms_token_index[] __attribute__((weak));
 
 extern const unsigned long kallsyms_markers[] __attribute__((weak));
 
+/* symbol indices sorted by name */
+extern const u32 kallsyms_seqs_of_names[] __attribute__((weak));
+
 static inline int is_kernel_text(unsigned long addr)
 {
 	if (addr >= (unsigned long)_stext && addr <= (unsigned long)_end)
@@ -88,20 +91,37 @@ static unsigned int get_symbol_offset(unsigned long pos)
 	return name - kallsyms_names;
 }
 
-/* Lookup the address for this symbol. Returns 0 if not found. */
-unsigned long kallsyms_lookup_name(const char *name)
+static int kallsyms_compare_name(unsigned long i, const char *name)
 {
 	char namebuf[KSYM_NAME_LEN];
-	unsigned long i;
-	unsigned int off;
 
-	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
-		off = kallsyms_expand_symbol(off, namebuf);
+	kallsyms_expand_symbol(get_symbol_offset(kallsyms_seqs_of_names[i]),
+			       namebuf);
+
+	return strcmp(namebuf, name);
+}
 
-		if (strcmp(namebuf, name) == 0)
-			return kallsyms_addresses[i];
+/* Lookup the address for this symbol. Returns 0 if not found. */
+unsigned long kallsyms_lookup_name(const char *name)
+{
+	unsigned long low = 0, high = kallsyms_num_syms, mid;
+
+	/*
+	 * Do a binary search on the name sorted index for the first
+	 * symbol of that name, which is also the one with the lowest
+	 * address.
+	 */
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (kallsyms_compare_name(mid, name) < 0)
+			low = mid + 1;
+		else
+			high = mid;
 	}
 
+	if (low < kallsyms_num_syms && !kallsyms_compare_name(low, name))
+		return kallsyms_addresses[kallsyms_seqs_of_names[low]];
+
 	/* module kallsyms not yet supported */
 	return 0;
 }
@@ -17,6 +17,9 @@
 #include <memtest.h>
 #include <malloc.h>
 #include <mmu.h>
+#include <clock.h>
+#include <smp_pool.h>
+#include <linux/math64.h>
 
 static int alloc_memtest_region(struct list_head *list,
 		resource_size_t start, resource_size_t size)
@@ -342,17 +345,248 @@ int mem_test_bus_integrity(resource_size_t _start,
 	return 0;
 }
 
-static int update_progress(resource_size_t offset, unsigned flags)
+/*
+ * The tests below sweep the whole region at a time, so that caches can't
+ * hide errors between writing and verifying a location. A sweep is split
+ * into blocks which are spread over all CPUs of the SMP worker pool. The
+ * boot CPU checks for ctrl-c and updates the progress bar between blocks
+ * instead of doing so for every word.
+ */
+#define MEM_TEST_BLOCK		SZ_1M
+#define MEM_TEST_BLOCK_WORDS	(MEM_TEST_BLOCK / sizeof(resource_size_t))
+#define MEM_TEST_BITS		(8 * sizeof(resource_size_t))
+
+enum mem_test_kind {
+	MEM_TEST_ADDRESS,	/* word index + 1 */
+	MEM_TEST_ALTERNATE,	/* a and b on even and odd words */
+	MEM_TEST_WALK,		/* one bit walking through a */
+	MEM_TEST_SPREAD,	/* two bits spread apart, alternately inverted */
+	MEM_TEST_RANDOM,	/* pseudo random, seeded with a */
+};
+
+struct mem_test_pattern {
+	const char *name;
+	enum mem_test_kind kind;
+	resource_size_t a, b;
+};
+
+/*
+ * Each pattern is written, then verified and inverted, then verified
+ * and cleared.
+ */
+enum mem_test_sweep {
+	MEM_TEST_FILL,
+	MEM_TEST_INVERT,
+	MEM_TEST_CLEAR,
+	MEM_TEST_SWEEPS,
+};
+
+struct mem_test_failure {
+	resource_size_t *address;
+	resource_size_t expected, actual;
+};
+
+static inline resource_size_t mem_test_random(resource_size_t idx,
+					      resource_size_t seed)
 {
-	/* Only check every 4k to reduce overhead */
-	if (offset & (SZ_4K - 1))
-		return 0;
+	u64 x = (u64)(idx ^ seed) * 0x9e3779b97f4a7c15ULL;
 
-	if (ctrlc())
-		return -EINTR;
+	x ^= x >> 31;
+	x *= 0xbf58476d1ce4e5b9ULL;
 
-	if (flags & MEMTEST_VERBOSE)
-		show_progress(offset);
+	return x ^ (x >> 29);
+}
+
+#define MEM_TEST_LOOP(gen)						\
+	switch (sweep) {						\
+	case MEM_TEST_FILL:						\
+		for (i = 0; i < n; i++) {				\
+			resource_size_t idx = first + i;		\
+									\
+			p[i] = (gen);					\
+		}							\
+		break;							\
+	case MEM_TEST_INVERT:						\
+		for (i = 0; i < n; i++) {				\
+			resource_size_t idx = first + i, want = (gen);	\
+									\
+			if (unlikely(p[i] != want))			\
+				goto fail;				\
+			p[i] = ~want;					\
+		}							\
+		break;							\
+	default:							\
+		for (i = 0; i < n; i++) {				\
+			resource_size_t idx = first + i, want = ~(gen);	\
+									\
+			if (unlikely(p[i] != want))			\
+				goto fail;				\
+			p[i] = 0;					\
+		}							\
+		break;							\
+	}
+
+/*
+ * Run one sweep over @n words at @p, which are the words @first..@first+@n-1
+ * of the region. Plain accesses are fine here: the sweeps of a region are
+ * separate calls, so the compiler can neither drop the stores nor satisfy
+ * the loads from registers, and it is free to use its widest load/store
+ * instructions.
+ */
+static bool mem_test_sweep(resource_size_t *p, resource_size_t n,
+			   resource_size_t first,
+			   const struct mem_test_pattern *pat,
+			   enum mem_test_sweep sweep,
+			   struct mem_test_failure *failure)
+{
+	resource_size_t a = pat->a, b = pat->b, i;
+
+	switch (pat->kind) {
+	case MEM_TEST_ADDRESS:
+		MEM_TEST_LOOP(idx + 1);
+		break;
+	case MEM_TEST_ALTERNATE:
+		MEM_TEST_LOOP(idx & 1 ? b : a);
+		break;
+	case MEM_TEST_WALK:
+		MEM_TEST_LOOP(a ^ ((resource_size_t)1 << (idx % MEM_TEST_BITS)));
+		break;
+	case MEM_TEST_SPREAD:
+		MEM_TEST_LOOP(((resource_size_t)5 << ((idx >> 1) % (MEM_TEST_BITS - 2))) ^
+			      (idx & 1 ? ~(resource_size_t)0 : 0));
+		break;
+	case MEM_TEST_RANDOM:
+		MEM_TEST_LOOP(mem_test_random(idx, a));
+		break;
+	}
+
+	barrier();
+
+	return true;
+fail:
+	failure->address = &p[i];
+	failure->actual = p[i];
+	/* recompute the expected value the cheap way */
+	mem_test_sweep(&failure->expected, 1, first + i, pat, MEM_TEST_FILL, NULL);
+	if (sweep == MEM_TEST_CLEAR)
+		failure->expected = ~failure->expected;
+
+	return false;
+}
+
+struct mem_test_job {
+	resource_size_t *start;
+	resource_size_t num_words;
+	resource_size_t first;
+	const struct mem_test_pattern *pat;
+	enum mem_test_sweep sweep;
+	struct mem_test_failure *failures;
+	bool *failed;
+};
+
+static void mem_test_block(void *data, unsigned int idx, unsigned int cpu)
+{
+	struct mem_test_job *job = data;
+	resource_size_t first = job->first + idx * MEM_TEST_BLOCK_WORDS;
+	resource_size_t n;
+
+	if (first >= job->num_words)
+		return;
+
+	n = min_t(resource_size_t, MEM_TEST_BLOCK_WORDS, job->num_words - first);
+
+	job->failed[idx] = !mem_test_sweep(job->start + first, n, first,
+					   job->pat, job->sweep,
+					   &job->failures[idx]);
+}
+
+/**
+ * mem_test_rate - compute a memory test throughput
+ * @bytes: number of bytes touched
+ * @ns: time taken in nanoseconds
+ *
+ * Return: the throughput in units of 0.01 MiB/s. Computed in KiB, so that
+ * it doesn't overflow for the whole DRAM of a board.
+ */
+u64 mem_test_rate(u64 bytes, u64 ns)
+{
+	return div64_u64(div_u64(bytes, SZ_1K) * (100ULL * NSEC_PER_SEC / SZ_1K),
+			 max_t(u64, ns, 1));
+}
+
+static int mem_test_pattern(resource_size_t *start, resource_size_t num_words,
+			    const struct mem_test_pattern *pat,
+			    const char *failure_description, unsigned flags)
+{
+	unsigned int blocks = smp_pool_cpus(), i;
+	resource_size_t step = blocks * MEM_TEST_BLOCK_WORDS;
+	struct mem_test_job job = {
+		.start = start,
+		.num_words = num_words,
+		.pat = pat,
+	};
+	u64 t0 = get_time_ns(), ns, bytes;
+	int ret = 0;
+
+	job.failures = xzalloc(blocks * sizeof(*job.failures));
+	job.failed = xzalloc(blocks * sizeof(*job.failed));
+
+	for (job.sweep = MEM_TEST_FILL; job.sweep < MEM_TEST_SWEEPS; job.sweep++) {
+		for (job.first = 0; job.first < num_words; job.first += step) {
+			if (ctrlc()) {
+				ret = -EINTR;
+				goto out;
+			}
+
+			if (flags & MEMTEST_VERBOSE)
+				show_progress(job.sweep * num_words + job.first);
+
+			smp_pool_run(mem_test_block, &job, blocks);
+
+			for (i = 0; i < blocks; i++) {
+				struct mem_test_failure *f = &job.failures[i];
+
+				if (!job.failed[i])
+					continue;
+
+				printf("\n");
+				mem_test_report_failure(failure_description,
+							f->expected, f->actual,
+							f->address);
+				ret = -EIO;
+				goto out;
+			}
+		}
+	}
+
+	if (flags & MEMTEST_VERBOSE) {
+		show_progress(MEM_TEST_SWEEPS * num_words);
+
+		ns = get_time_ns() - t0;
+		bytes = (u64)MEM_TEST_SWEEPS * num_words * sizeof(resource_size_t);
+		bytes = mem_test_rate(bytes, ns);
+
+		printf("\n%s: %llu.%02llu MiB/s on %u CPU%s\n", pat->name,
+		       bytes / 100, bytes % 100, blocks, blocks > 1 ? "s" : "");
+	}
+out:
+	free(job.failures);
+	free(job.failed);
+
+	return ret;
+}
+
+static int mem_test_prepare(resource_size_t *_start, resource_size_t *_end,
+			    resource_size_t **start, resource_size_t *num_words)
+{
+	*_start = ALIGN(*_start, sizeof(resource_size_t));
+	*_end = ALIGN_DOWN(*_end, sizeof(resource_size_t)) - 1;
+
+	if (*_end <= *_start)
+		return -EINVAL;
+
+	*start = (resource_size_t *)*_start;
+	*num_words = (*_end - *_start + 1) / sizeof(resource_size_t);
 
 	return 0;
 }
@@ -360,23 +594,22 @@ static int update_progress(resource_size_t offset, unsigned flags)
 int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 			       unsigned flags)
 {
-	volatile resource_size_t *start, num_words, offset, temp, anti_pattern;
+	static const struct mem_test_pattern address = {
+		.name = "moving inversions",
+		.kind = MEM_TEST_ADDRESS,
+	};
+	resource_size_t *start, num_words;
 	int ret;
 
-	_start = ALIGN(_start, sizeof(resource_size_t));
-	_end = ALIGN_DOWN(_end, sizeof(resource_size_t)) - 1;
-
-	if (_end <= _start)
-		return -EINVAL;
-
-	start = (resource_size_t *)_start;
-	num_words = (_end - _start + 1)/sizeof(resource_size_t);
+	ret = mem_test_prepare(&_start, &_end, &start, &num_words);
+	if (ret)
+		return ret;
 
 	if (flags & MEMTEST_VERBOSE) {
 		printf("Starting moving inversions test of RAM:\n"
 		       "Fill with address, compare, fill with inverted address, compare again\n");
 
-		init_progression_bar(3 * num_words);
+		init_progression_bar(MEM_TEST_SWEEPS * num_words);
 	}
 
 	/*
@@ -389,58 +622,49 @@ int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 	 *		and the size of the region are
 	 *		selected by the caller.
 	 */
+	return mem_test_pattern(start, num_words, &address, "read/write", flags);
+}
 
-	/* Fill memory with a known pattern */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(offset, flags);
-		if (ret)
-			return ret;
-		start[offset] = offset + 1;
-	}
+/**
+ * mem_test_patterns - test a memory region with the memtester patterns
+ * @_start: start address of the region
+ * @_end: end address of the region (inclusive)
+ * @flags: MEMTEST_* flags
+ *
+ * Writes, verifies, inverts and verifies again solid bits, checkerboard,
+ * walking ones and zeroes, bit spread and pseudo random patterns over
+ * the whole region.
+ */
+int mem_test_patterns(resource_size_t _start, resource_size_t _end,
+		      unsigned flags)
+{
+	struct mem_test_pattern patterns[] = {
+		{ "solid bits", MEM_TEST_ALTERNATE, ~(resource_size_t)0, 0 },
+		{ "checkerboard", MEM_TEST_ALTERNATE,
+		  (resource_size_t)0x5555555555555555ULL,
+		  (resource_size_t)0xaaaaaaaaaaaaaaaaULL },
+		{ "walking ones", MEM_TEST_WALK, 0 },
+		{ "walking zeroes", MEM_TEST_WALK, ~(resource_size_t)0 },
+		{ "bit spread", MEM_TEST_SPREAD },
+		{ "random", MEM_TEST_RANDOM, get_time_ns() },
+	};
+	resource_size_t *start, num_words;
+	int i, ret;
 
-	/* Check each location and invert it for the second pass */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(num_words + offset, flags);
-		if (ret)
-			return ret;
+	ret = mem_test_prepare(&_start, &_end, &start, &num_words);
+	if (ret)
+		return ret;
 
-		temp = start[offset];
-		if (temp != (offset + 1)) {
-			printf("\n");
-			mem_test_report_failure("read/write",
-						(offset + 1),
-						temp, &start[offset]);
-			return -EIO;
+	for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+		if (flags & MEMTEST_VERBOSE) {
+			printf("Testing %s pattern:\n", patterns[i].name);
+			init_progression_bar(MEM_TEST_SWEEPS * num_words);
 		}
 
-		anti_pattern = ~(offset + 1);
-		start[offset] = anti_pattern;
-	}
-
-	/* Check each location for the inverted pattern and zero it */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(2 * num_words + offset, flags);
+		ret = mem_test_pattern(start, num_words, &patterns[i],
+				       patterns[i].name, flags);
 		if (ret)
 			return ret;
-
-		anti_pattern = ~(offset + 1);
-		temp = start[offset];
-
-		if (temp != anti_pattern) {
-			printf("\n");
-			mem_test_report_failure("read/write",
-						anti_pattern,
-						temp, &start[offset]);
-			return -EIO;
-		}
-
-		start[offset] = 0;
-	}
-	if (flags & MEMTEST_VERBOSE) {
-		show_progress(3 * num_words);
-
-		/* end of progressbar */
-		printf("\n");
 	}
 
 	return 0;
@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * smp_pool.c - run embarrassingly parallel work on secondary CPUs
+ *
+ * barebox itself is single threaded. The pool only lends the otherwise
+ * idle secondary CPUs to the boot CPU for the duration of a single
+ * smp_pool_run() call: secondaries spin in a parked loop, pick work item
+ * indices off a shared counter while a job is published and go back to
+ * waiting afterwards. Before barebox hands over to the OS, the secondaries
+ * leave the loop and are powered down again, so the OS finds them in the
+ * same state as if barebox had never touched them.
+ */
+#define pr_fmt(fmt) "smp-pool: " fmt
+
+#include <common.h>
+#include <init.h>
+#include <clock.h>
+#include <smp_pool.h>
+#include <linux/bitmap.h>
+#include <linux/sizes.h>
+
+static const struct smp_pool_ops *pool_ops;
+static unsigned int pool_ncpus;
+static unsigned int pool_online;
+/* CPUs started with ->cpu_start() and not yet confirmed to be off */
+static unsigned long *pool_started_mask;
+static bool pool_failed, pool_running;
+
+static struct {
+	smp_pool_fn fn;
+	void *data;
+	unsigned int n;
+	unsigned int next;
+	unsigned int busy;
+	unsigned int gen;
+	bool exit;
+} job;
+
+/**
+ * smp_pool_register - register the architecture backend of the pool
+ * @ops: backend operations
+ * @ncpus: number of CPUs in the system including the boot CPU
+ *
+ * Secondaries are numbered 1 to @ncpus - 1 and are only started on the
+ * first smp_pool_run() that has more than one work item.
+ */
+int smp_pool_register(const struct smp_pool_ops *ops, unsigned int ncpus)
+{
+	if (pool_ops)
+		return -EBUSY;
+	if (ncpus < 2)
+		return -ENODEV;
+
+	pool_started_mask = bitmap_xzalloc(ncpus);
+	pool_ncpus = ncpus;
+	pool_ops = ops;
+
+	pr_debug("registered %u CPUs\n", ncpus);
+
+	return 0;
+}
+
+static void smp_pool_work(unsigned int cpu)
+{
+	unsigned int idx;
+
+	while ((idx = __atomic_fetch_add(&job.next, 1, __ATOMIC_RELAXED)) < job.n)
+		job.fn(job.data, idx, cpu);
+}
+
+/**
+ * smp_pool_secondary_main - parked loop of a secondary CPU
+ * @cpu: logical pool CPU number
+ *
+ * Called by the backend on the secondary CPU once it runs with the same
+ * memory view as the boot CPU.
+ */
+void smp_pool_secondary_main(unsigned int cpu)
+{
+	unsigned int gen, cur;
+
+	if (READ_ONCE(pool_failed))
+		pool_ops->cpu_exit(cpu);
+
+	gen = __atomic_load_n(&job.gen, __ATOMIC_ACQUIRE);
+	__atomic_fetch_add(&pool_online, 1, __ATOMIC_RELEASE);
+	pool_ops->kick();
+
+	/*
+	 * job.exit stays set until all started CPUs are off, so a CPU that
+	 * comes up only after the pool was parked leaves right away.
+	 */
+	for (;;) {
+		while ((cur = __atomic_load_n(&job.gen, __ATOMIC_ACQUIRE)) == gen &&
+		       !READ_ONCE(job.exit))
+			pool_ops->wait();
+
+		if (READ_ONCE(job.exit))
+			break;
+
+		gen = cur;
+
+		if (pool_ops->sync)
+			pool_ops->sync();
+
+		smp_pool_work(cpu);
+
+		__atomic_fetch_sub(&job.busy, 1, __ATOMIC_RELEASE);
+		pool_ops->kick();
+	}
+
+	pool_ops->cpu_exit(cpu);
+}
+
+static unsigned int smp_pool_start(void)
+{
+	unsigned int cpu, expected;
+	uint64_t start;
+	int ret;
+
+	if (!pool_ops || pool_failed)
+		return 0;
+	if (pool_online)
+		return pool_online;
+
+	for (cpu = 1; cpu < pool_ncpus; cpu++) {
+		expected = pool_online + 1;
+
+		ret = pool_ops->cpu_start(cpu);
+		if (ret) {
+			pr_warn("cannot start CPU%u: %pe\n", cpu, ERR_PTR(ret));
+			continue;
+		}
+
+		set_bit(cpu, pool_started_mask);
+
+		start = get_time_ns();
+		while (__atomic_load_n(&pool_online, __ATOMIC_ACQUIRE) != expected) {
+			if (is_timeout_non_interruptible(start, 100 * MSECOND)) {
+				pr_err("CPU%u did not come up, disabling pool\n", cpu);
+				WRITE_ONCE(pool_failed, true);
+				smp_pool_park();
+				return 0;
+			}
+		}
+	}
+
+	pr_debug("%u secondary CPUs online\n", pool_online);
+
+	return pool_online;
+}
+
+static void smp_pool_publish(void)
+{
+	job.busy = pool_online;
+	__atomic_store_n(&job.gen, job.gen + 1, __ATOMIC_RELEASE);
+	pool_ops->kick();
+}
+
+static void smp_pool_wait_idle(void)
+{
+	while (__atomic_load_n(&job.busy, __ATOMIC_ACQUIRE))
+		pool_ops->wait();
+}
+
+/**
+ * smp_pool_cpus - number of CPUs work items may run on
+ *
+ * Use this to size per-CPU scratch data indexed by the @cpu argument of
+ * the work item callback.
+ */
+unsigned int smp_pool_cpus(void)
+{
+	return pool_ops && !pool_failed ? pool_ncpus : 1;
+}
+
+/**
+ * smp_pool_online - check if secondary CPUs are running
+ *
+ * Secondaries stay online between jobs until smp_pool_park(). While they
+ * are, page table changes must be made visible to them as well.
+ */
+bool smp_pool_online(void)
+{
+	return __atomic_load_n(&pool_online, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * smp_pool_run - run work items on all available CPUs
+ * @fn: work item callback
+ * @data: opaque pointer passed to @fn
+ * @n: number of work items
+ *
+ * Calls @fn for every index in 0..@n-1 exactly once, distributed over the
+ * boot CPU and all secondaries, and returns after all items have finished.
+ * Without a pool, or when called from within a work item, the items are
+ * run sequentially on the calling CPU.
+ */
+void smp_pool_run(smp_pool_fn fn, void *data, unsigned int n)
+{
+	unsigned int i;
+
+	if (n > 1 && !pool_running && smp_pool_start()) {
+		pool_running = true;
+
+		job.fn = fn;
+		job.data = data;
+		job.n = n;
+		job.next = 0;
+		smp_pool_publish();
+
+		smp_pool_work(0);
+		smp_pool_wait_idle();
+
+		pool_running = false;
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		fn(data, i, 0);
+}
+
+/**
+ * smp_pool_park - power down all secondary CPUs
+ *
+ * Called automatically on shutdown before the OS is started. The pool
+ * restarts the secondaries on the next smp_pool_run().
+ *
+ * This waits for every CPU that was ever started, including those that
+ * did not show up in time. If one of them can't be confirmed to be off,
+ * the pool stays disabled and the error is returned.
+ *
+ * Return: 0 if all secondaries are off, a negative error code otherwise
+ */
+int smp_pool_park(void)
+{
+	unsigned int cpu;
+	int ret, err = 0;
+
+	if (!pool_ops || find_first_bit(pool_started_mask, pool_ncpus) >= pool_ncpus)
+		return 0;
+
+	WRITE_ONCE(job.exit, true);
+	smp_pool_publish();
+
+	for_each_set_bit(cpu, pool_started_mask, pool_ncpus) {
+		ret = pool_ops->cpu_wait_off(cpu);
+		if (ret) {
+			pr_err("CPU%u failed to power down: %pe\n", cpu, ERR_PTR(ret));
+			err = ret;
+			continue;
+		}
+		clear_bit(cpu, pool_started_mask);
+	}
+
+	if (err) {
+		WRITE_ONCE(pool_failed, true);
+		return err;
+	}
+
+	WRITE_ONCE(job.exit, false);
+	pool_online = 0;
+
+	return 0;
+}
+
+static void smp_pool_shutdown(void)
+{
+	/* never let the OS find a CPU still running barebox code */
+	if (smp_pool_park())
+		panic("secondary CPUs still running, refusing to continue");
+}
+early_exitcall(smp_pool_shutdown);
+
+struct smp_mem_job {
+	void *dest;
+	const void *src;
+	int c;
+	size_t len;
+	size_t chunk;
+};
+
+/* Below this, waking up the secondaries costs more than it saves */
+#define SMP_MEM_MIN	SZ_1M
+
+static unsigned int smp_mem_split(struct smp_mem_job *mj)
+{
+	unsigned int nchunks = smp_pool_cpus() * 4;
+
+	/* chunk boundaries on cache lines, so CPUs don't share them */
+	mj->chunk = ALIGN(DIV_ROUND_UP(mj->len, nchunks), SZ_64);
+
+	return DIV_ROUND_UP(mj->len, mj->chunk);
+}
+
+static void smp_memset_fn(void *data, unsigned int idx, unsigned int cpu)
+{
+	struct smp_mem_job *mj = data;
+	size_t off = (size_t)idx * mj->chunk;
+
+	memset(mj->dest + off, mj->c, min(mj->chunk, mj->len - off));
+}
+
+/**
+ * smp_memset - memset() split over all pool CPUs
+ */
+void *smp_memset(void *s, int c, size_t n)
+{
+	struct smp_mem_job mj = { .dest = s, .c = c, .len = n };
+
+	if (n < SMP_MEM_MIN || smp_pool_cpus() == 1)
+		return memset(s, c, n);
+
+	smp_pool_run(smp_memset_fn, &mj, smp_mem_split(&mj));
+
+	return s;
+}
+
+static void smp_memcpy_fn(void *data, unsigned int idx, unsigned int cpu)
+{
+	struct smp_mem_job *mj = data;
+	size_t off = (size_t)idx * mj->chunk;
+
+	memcpy(mj->dest + off, mj->src + off, min(mj->chunk, mj->len - off));
+}
+
+/**
+ * smp_memcpy - memcpy() split over all pool CPUs
+ *
+ * Like memcpy(), the buffers must not overlap.
+ */
+void *smp_memcpy(void *dest, const void *src, size_t n)
+{
+	struct smp_mem_job mj = { .dest = dest, .src = src, .len = n };
+
+	if (n < SMP_MEM_MIN || smp_pool_cpus() == 1)
+		return memcpy(dest, src, n);
+
+	smp_pool_run(smp_memcpy_fn, &mj, smp_mem_split(&mj));
+
+	return dest;
+}
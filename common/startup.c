@@ -38,8 +38,11 @@
 #include <watchdog.h>
 #include <glob.h>
 #include <net.h>
+#include <initcall_report.h>
+#include <of.h>
 #include <efi/efi-mode.h>
 #include <bselftest.h>
+#include <boottrace.h>
 
 extern initcall_t __barebox_initcalls_start[], __barebox_early_initcalls_end[],
 		  __barebox_initcalls_end[];
@@ -310,6 +313,8 @@ static int run_init(void)
 	if (autoboot == AUTOBOOT_BOOT)
 		run_command("boot");
 
+	log_release_deferred();
+
 	if (IS_ENABLED(CONFIG_NET))
 		eth_open_all();
 
@@ -338,6 +343,16 @@ static void do_ctors(void)
 #endif
 }
 
+int initcall_machine_match(const char *compat)
+{
+	if (of_machine_is_compatible(compat))
+		return 1;
+
+	initcall_report_skipped();
+
+	return 0;
+}
+
 int (*barebox_main)(void);
 
 void __noreturn start_barebox(void)
@@ -352,8 +367,13 @@ void __noreturn start_barebox(void)
 
 	for (initcall = __barebox_initcalls_start;
 			initcall < __barebox_initcalls_end; initcall++) {
+		u64 start = boottrace_start();
+		u64 report_start = initcall_report_start();
+
 		pr_debug("initcall-> %pS\n", *initcall);
 		result = (*initcall)();
+		boottrace_record("initcall", start, "%pS", *initcall);
+		initcall_report_record(*initcall, report_start);
 		if (result)
 			pr_err("initcall %pS failed: %s\n", *initcall,
 					strerror(-result));
@@ -367,6 +387,9 @@ void __noreturn start_barebox(void)
 	if (barebox_main)
 		barebox_main();
 
+	/* init may have dropped to the shell before releasing the log */
+	log_release_deferred();
+
 	if (IS_ENABLED(CONFIG_SHELL_NONE)) {
 		pr_err("Nothing left to do\n");
 		hang();
@@ -14,6 +14,7 @@
 
 #include <asm-generic/ioctl.h>
 #include <common.h>
+#include <crc.h>
 #include <fcntl.h>
 #include <fs.h>
 #include <libfile.h>
@@ -43,6 +44,13 @@
  *
  * If your device is a mtd device, but does not have eraseblocks, like MRAMs, then
  * the direct bucket is used instead.
+ *
+ * With CONFIG_STATE_CIRCULAR_DELTA enabled, a new state which only differs in
+ * a few bytes from the one already stored in the eraseblock is written as a
+ * delta record containing only the changed byte ranges. Reading replays all
+ * delta records on top of the last full copy. Once the eraseblock is full, the
+ * next write erases it and starts over with a full copy again. Delta records
+ * are always understood when reading, regardless of the option.
  */
 struct state_backend_storage_bucket_circular {
 	struct state_backend_storage_bucket bucket;
@@ -53,6 +61,10 @@ struct state_backend_storage_bucket_circular {
 
 	off_t write_area; /* Start of the write area (relative offset) */
 	uint32_t last_written_length; /* Size of the data written in the storage */
+	bool last_is_delta; /* Last record in the storage is a delta record */
+
+	void *cur; /* Data currently stored, base for delta records */
+	ssize_t cur_len;
 
 #ifdef __BAREBOX__
 	struct mtd_info *mtd; /* mtd info (used for io in Barebox)*/
@@ -76,6 +88,24 @@ struct __attribute__((__packed__)) state_backend_storage_bucket_circular_meta {
 };
 
 static const uint32_t circular_magic = 0x14fa2d02;
+static const uint32_t circular_delta_magic = 0x14fa2d03;
+
+/*
+ * A delta record contains this header followed by @data_len bytes of ranges.
+ * Each range is a struct state_backend_storage_bucket_circular_range followed
+ * by the new content of the range. @crc covers everything after itself, so
+ * that partially written delta records are detected.
+ */
+struct __attribute__((__packed__)) state_backend_storage_bucket_circular_delta {
+	uint32_t crc;
+	uint32_t len; /* Length of the resulting data */
+	uint32_t data_len;
+};
+
+struct __attribute__((__packed__)) state_backend_storage_bucket_circular_range {
+	uint32_t offset;
+	uint32_t len;
+};
 
 static inline struct state_backend_storage_bucket_circular
     *get_bucket_circular(struct state_backend_storage_bucket *bucket)
@@ -224,6 +254,144 @@ static int state_mtd_peb_erase(struct state_backend_storage_bucket_circular *cir
 }
 #endif
 
+static void circular_set_cur(struct state_backend_storage_bucket_circular *circ,
+			     const void *buf, ssize_t len)
+{
+	free(circ->cur);
+	circ->cur = buf ? xmemdup(buf, len) : NULL;
+	circ->cur_len = len;
+}
+
+/*
+ * Apply the delta record @delta of @size bytes to @buf, which holds the @len
+ * bytes of data resulting from the previous records.
+ */
+static int circular_apply_delta(struct state_backend_storage_bucket_circular *circ,
+				void *buf, ssize_t len, const void *delta,
+				ssize_t size)
+{
+	const struct state_backend_storage_bucket_circular_delta *hdr = delta;
+	const struct state_backend_storage_bucket_circular_range *range;
+	const void *pos, *end;
+
+	if (size < sizeof(*hdr) || hdr->data_len > size - sizeof(*hdr))
+		return -EINVAL;
+
+	if (hdr->crc != crc32(0, delta + sizeof(hdr->crc),
+			      sizeof(*hdr) - sizeof(hdr->crc) + hdr->data_len)) {
+		dev_err(circ->dev, "Invalid CRC in delta record\n");
+		return -EINVAL;
+	}
+
+	if (hdr->len != len)
+		return -EINVAL;
+
+	pos = delta + sizeof(*hdr);
+	end = pos + hdr->data_len;
+
+	while (pos < end) {
+		if (end - pos < sizeof(*range))
+			return -EINVAL;
+
+		range = pos;
+		pos += sizeof(*range);
+
+		if (range->offset > len || range->len > len - range->offset ||
+		    range->len > end - pos)
+			return -EINVAL;
+
+		memcpy(buf + range->offset, pos, range->len);
+		pos += range->len;
+	}
+
+	return 0;
+}
+
+static off_t circular_record_end(const off_t *records, int i, off_t size)
+{
+	return i ? records[i - 1] : size;
+}
+
+/*
+ * Read the whole written area and replay all delta records on top of the last
+ * full record.
+ */
+static int circular_read_deltas(struct state_backend_storage_bucket_circular *circ,
+				void **buf_out, ssize_t *len_out)
+{
+	struct state_backend_storage_bucket_circular_meta *meta;
+	off_t size = circ->write_area, end = size, *records;
+	int i, ret, read_ret, num_records = 0;
+	ssize_t len;
+	void *area, *buf;
+
+	area = xmalloc(size);
+	records = xmalloc(sizeof(*records) * (size / circ->writesize));
+
+	/* keep -EUCLEAN to report it once the deltas are applied */
+	read_ret = state_mtd_peb_read(circ, area, 0, size);
+	if (read_ret < 0 && read_ret != -EUCLEAN) {
+		ret = read_ret;
+		goto out;
+	}
+
+	/* Walk backwards to the last full record */
+	while (1) {
+		if (end < sizeof(*meta)) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		meta = area + end - sizeof(*meta);
+		if (meta->magic != circular_magic &&
+		    meta->magic != circular_delta_magic) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		if (!meta->written_length || meta->written_length > end ||
+		    meta->written_length % circ->writesize) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		end -= meta->written_length;
+		records[num_records++] = end;
+
+		if (meta->magic == circular_magic)
+			break;
+	}
+
+	/* records[] holds the record start offsets, newest first */
+	len = circular_record_end(records, num_records - 1, size) -
+		records[num_records - 1] - sizeof(*meta);
+	buf = xmemdup(area + records[num_records - 1], len);
+
+	for (i = num_records - 2; i >= 0; i--) {
+		ret = circular_apply_delta(circ, buf, len, area + records[i],
+					   circular_record_end(records, i, size) -
+					   records[i] - sizeof(*meta));
+		if (ret) {
+			dev_err(circ->dev, "Invalid delta record at offset %lld\n",
+				(long long) records[i]);
+			free(buf);
+			goto out;
+		}
+	}
+
+	dev_dbg(circ->dev, "Read state from PEB %u with %d delta records\n",
+		circ->eraseblock, num_records - 1);
+
+	*buf_out = buf;
+	*len_out = len;
+	ret = read_ret == -EUCLEAN ? -EUCLEAN : 0;
+out:
+	free(records);
+	free(area);
+
+	return ret;
+}
+
 static int state_backend_bucket_circular_read(struct state_backend_storage_bucket *bucket,
 					      void ** buf_out,
 					      ssize_t * len_out)
@@ -235,10 +403,21 @@ static int state_backend_bucket_circular_read(struct state_backend_storage_bucke
 	void *buf;
 	int ret;
 
+	circular_set_cur(circ, NULL, 0);
+
 	/* Storage is empty */
 	if (circ->write_area == 0)
 		return -ENODATA;
 
+	if (circ->last_is_delta) {
+		ret = circular_read_deltas(circ, buf_out, len_out);
+		if (ret == -EINVAL)
+			circ->write_area = 0;
+		else if (!ret)
+			circular_set_cur(circ, *buf_out, *len_out);
+		return ret;
+	}
+
 	if (!circ->last_written_length) {
 		/*
 		 * Last write did not contain length information, assuming old
@@ -286,15 +465,76 @@ static int state_backend_bucket_circular_read(struct state_backend_storage_bucke
 		read_len -= sizeof(struct state_backend_storage_bucket_circular_meta);
 	*len_out = read_len;
 
+	if (!ret && circ->last_written_length)
+		circular_set_cur(circ, buf, read_len);
+
 	return ret;
 }
 
-static int state_backend_bucket_circular_write(struct state_backend_storage_bucket *bucket,
-					       const void * buf,
-					       ssize_t len)
+/*
+ * Create a delta record which turns circ->cur into @buf. Returns the size of
+ * the delta record or 0 if the delta record is not smaller than the data.
+ */
+static ssize_t circular_create_delta(struct state_backend_storage_bucket_circular *circ,
+				     const void *buf, void **delta_out)
+{
+	struct state_backend_storage_bucket_circular_delta *hdr;
+	struct state_backend_storage_bucket_circular_range range;
+	const uint8_t *old = circ->cur, *new = buf;
+	ssize_t i, len = circ->cur_len, size;
+	void *delta, *pos;
+
+	/* Worst case: every other byte changed */
+	delta = xzalloc(sizeof(*hdr) + (len / 2 + 1) * sizeof(range) + len);
+	hdr = delta;
+	pos = delta + sizeof(*hdr);
+
+	for (i = 0; i < len; i++) {
+		ssize_t end, gap;
+
+		if (old[i] == new[i])
+			continue;
+
+		/*
+		 * Extend the range over unchanged bytes as long as this is
+		 * cheaper than starting a new range.
+		 */
+		for (end = i + 1, gap = 0; end < len && gap <= sizeof(range); end++) {
+			if (old[end] != new[end])
+				gap = 0;
+			else
+				gap++;
+		}
+		end -= gap;
+
+		range.offset = i;
+		range.len = end - i;
+		memcpy(pos, &range, sizeof(range));
+		pos += sizeof(range);
+		memcpy(pos, new + i, range.len);
+		pos += range.len;
+
+		i = end;
+	}
+
+	size = pos - delta;
+	hdr->len = len;
+	hdr->data_len = size - sizeof(*hdr);
+	hdr->crc = crc32(0, delta + sizeof(hdr->crc), size - sizeof(hdr->crc));
+
+	if (size >= len) {
+		free(delta);
+		return 0;
+	}
+
+	*delta_out = delta;
+
+	return size;
+}
+
+static int circular_write_record(struct state_backend_storage_bucket_circular *circ,
+				 const void *buf, ssize_t len, uint32_t magic)
 {
-	struct state_backend_storage_bucket_circular *circ =
-	    get_bucket_circular(bucket);
 	off_t offset;
 	struct state_backend_storage_bucket_circular_meta *meta;
 	uint32_t written_length = roundup(len + sizeof(*meta), circ->writesize);
@@ -316,10 +556,15 @@ static int state_backend_bucket_circular_write(struct state_backend_storage_buck
 	memcpy(write_buf, buf, len);
 	meta = (struct state_backend_storage_bucket_circular_meta *)
 			(write_buf + written_length - sizeof(*meta));
-	meta->magic = circular_magic;
+	meta->magic = magic;
 	meta->written_length = written_length;
 
 	if (circ->write_area + written_length >= circ->max_size) {
+		/* Delta records never start a new eraseblock */
+		if (magic != circular_magic) {
+			ret = -ENOSPC;
+			goto out_free;
+		}
 		circ->write_area = 0;
 	}
 	/*
@@ -357,11 +602,58 @@ static int state_backend_bucket_circular_write(struct state_backend_storage_buck
 	dev_dbg(circ->dev, "Written state to PEB %u offset %lld length %u data length %zd\n",
 		circ->eraseblock, (long long) offset, written_length, len);
 
+	circ->last_written_length = written_length;
+	circ->last_is_delta = magic == circular_delta_magic;
+
 out_free:
 	free(write_buf);
 	return ret;
 }
 
+static int state_backend_bucket_circular_write(struct state_backend_storage_bucket *bucket,
+					       const void * buf,
+					       ssize_t len)
+{
+	struct state_backend_storage_bucket_circular *circ =
+	    get_bucket_circular(bucket);
+	struct state_backend_storage_bucket_circular_meta *meta;
+	ssize_t padded_len, delta_len = 0;
+	void *new, *delta;
+	int ret;
+
+	/* The data as it is returned when reading it back */
+	padded_len = roundup(len + sizeof(*meta), circ->writesize) - sizeof(*meta);
+	new = xzalloc(padded_len);
+	memcpy(new, buf, len);
+
+	if (IS_ENABLED(CONFIG_STATE_CIRCULAR_DELTA) && circ->cur &&
+	    circ->cur_len == padded_len && circ->write_area)
+		delta_len = circular_create_delta(circ, new, &delta);
+
+	if (delta_len) {
+		ret = circular_write_record(circ, delta, delta_len,
+					    circular_delta_magic);
+		free(delta);
+
+		/* Eraseblock is full, compact it into a new full copy */
+		if (ret == -ENOSPC)
+			ret = circular_write_record(circ, buf, len, circular_magic);
+	} else {
+		ret = circular_write_record(circ, buf, len, circular_magic);
+	}
+
+	if (ret < 0 && ret != -EUCLEAN) {
+		free(new);
+		new = NULL;
+	}
+
+	free(circ->cur);
+	circ->cur = new;
+	circ->cur_len = padded_len;
+
+	return ret;
+}
+
 /**
  * state_backend_bucket_circular_init - Initialize circular bucket
  * @param bucket
@@ -398,12 +690,15 @@ static int state_backend_bucket_circular_init(
 			meta = (struct state_backend_storage_bucket_circular_meta *)
 					(buf + sub_offset + circ->writesize - sizeof(*meta));
 
-			if (meta->magic != circular_magic) {
+			if (meta->magic != circular_magic &&
+			    meta->magic != circular_delta_magic) {
 				written_length = 0;
 				if (meta->magic != ~0 && !!meta->magic)
 					bucket->wrong_magic = 1;
 			} else {
 				written_length = meta->written_length;
+				circ->last_is_delta =
+					meta->magic == circular_delta_magic;
 			}
 			break;
 		}
@@ -426,6 +721,7 @@ static void state_backend_bucket_circular_free(struct
 	struct state_backend_storage_bucket_circular *circ =
 	    get_bucket_circular(bucket);
 
+	free(circ->cur);
 	free(circ);
 }
 
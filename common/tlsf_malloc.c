@@ -5,6 +5,7 @@
  * Copyright (C) 2011 Antony Pavlov <antonynpavlov@gmail.com>
  */
 
+#include <common.h>
 #include <malloc.h>
 #include <string.h>
 
@@ -14,7 +15,148 @@
 
 extern tlsf_t tlsf_mem_pool;
 
-void *malloc(size_t bytes)
+/*
+ * Size classes in front of TLSF
+ *
+ * Most allocations in barebox are small and of a handful of recurring
+ * sizes. Requests up to MALLOC_CLASS_MAX bytes are rounded up to a size
+ * class and freed blocks of these classes are kept on a per class free
+ * list instead of being merged back into the TLSF pool. The cached
+ * blocks stay allocated as far as TLSF is concerned, so realloc(),
+ * malloc_usable_size() and free() work on them unchanged. They are handed
+ * back to TLSF when an allocation would otherwise fail.
+ */
+#define MALLOC_CLASS_MAX	512
+#define MALLOC_CLASS_CACHE	64
+
+static const unsigned short malloc_class_size[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+};
+
+#define MALLOC_NUM_CLASSES	ARRAY_SIZE(malloc_class_size)
+
+struct malloc_class {
+	void *free;
+	unsigned int cached;
+	unsigned long allocs;
+	unsigned long hits;
+};
+
+static struct malloc_class malloc_classes[MALLOC_NUM_CLASSES];
+
+/* smallest class for a size, indexed by (size + 15) / 16 */
+static u8 malloc_class_index[MALLOC_CLASS_MAX / 16 + 1];
+
+static bool malloc_use_classes(void)
+{
+	/* cached blocks would hide use-after-free from KASAN */
+	return IS_ENABLED(CONFIG_MALLOC_SIZE_CLASSES) && !IS_ENABLED(CONFIG_KASAN);
+}
+
+static void malloc_class_init(void)
+{
+	unsigned int i, c = 0;
+
+	for (i = 0; i < ARRAY_SIZE(malloc_class_index); i++) {
+		while (malloc_class_size[c] < i * 16)
+			c++;
+		malloc_class_index[i] = c;
+	}
+}
+
+static int malloc_class_of(size_t bytes)
+{
+	if (bytes > MALLOC_CLASS_MAX)
+		return -1;
+
+	if (unlikely(!malloc_class_index[ARRAY_SIZE(malloc_class_index) - 1]))
+		malloc_class_init();
+
+	return malloc_class_index[(bytes + 15) / 16];
+}
+
+static void malloc_class_flush(void)
+{
+	struct malloc_class *mc;
+	void *mem;
+
+	for (mc = malloc_classes; mc < &malloc_classes[MALLOC_NUM_CLASSES]; mc++) {
+		while ((mem = mc->free)) {
+			mc->free = *(void **)mem;
+			tlsf_free(tlsf_mem_pool, mem);
+		}
+		mc->cached = 0;
+	}
+}
+
+#ifdef CONFIG_MALLOC_STATS
+#define MALLOC_CALLERS	512
+
+struct malloc_caller {
+	unsigned long ip;
+	unsigned long count;
+	size_t bytes;
+};
+
+static struct malloc_caller malloc_callers[MALLOC_CALLERS];
+static unsigned long malloc_callers_lost;
+
+static void malloc_record_caller(unsigned long ip, size_t bytes)
+{
+	unsigned int i, h = (ip >> 2) % MALLOC_CALLERS;
+
+	for (i = 0; i < MALLOC_CALLERS; i++) {
+		struct malloc_caller *c = &malloc_callers[(h + i) % MALLOC_CALLERS];
+
+		if (c->ip != ip && c->ip)
+			continue;
+
+		c->ip = ip;
+		c->count++;
+		c->bytes += bytes;
+		return;
+	}
+
+	malloc_callers_lost++;
+}
+#else
+static inline void malloc_record_caller(unsigned long ip, size_t bytes)
+{
+}
+#endif
+
+static void *malloc_sized(size_t bytes)
+{
+	struct malloc_class *mc;
+	void *mem;
+	int c;
+
+	c = malloc_use_classes() ? malloc_class_of(bytes) : -1;
+	if (c >= 0) {
+		mc = &malloc_classes[c];
+		mc->allocs++;
+
+		mem = mc->free;
+		if (mem) {
+			mc->free = *(void **)mem;
+			mc->cached--;
+			mc->hits++;
+			return mem;
+		}
+
+		bytes = malloc_class_size[c];
+	}
+
+	mem = tlsf_malloc(tlsf_mem_pool, bytes);
+	if (!mem && malloc_use_classes()) {
+		malloc_class_flush();
+		mem = tlsf_malloc(tlsf_mem_pool, bytes);
+	}
+
+	return mem;
+}
+
+static void *malloc_from(size_t bytes, unsigned long caller)
 {
 	void *mem;
 	/*
@@ -24,16 +166,60 @@ void *malloc(size_t bytes)
 	if (!bytes)
 		bytes = 1;
 
-	mem = tlsf_malloc(tlsf_mem_pool, bytes);
+	malloc_record_caller(caller, bytes);
+
+	mem = malloc_sized(bytes);
 	if (!mem)
 		errno = ENOMEM;
 
 	return mem;
 }
+
+void *malloc(size_t bytes)
+{
+	return malloc_from(bytes, _RET_IP_);
+}
 EXPORT_SYMBOL(malloc);
 
+#ifdef CONFIG_MALLOC_STATS
+/*
+ * For allocation wrappers like xmalloc(), so that the statistics show
+ * their callers instead of the wrapper
+ */
+void *__malloc_caller(size_t bytes, unsigned long caller)
+{
+	return malloc_from(bytes, caller);
+}
+EXPORT_SYMBOL(__malloc_caller);
+#endif
+
 void free(void *mem)
 {
+	struct malloc_class *mc;
+	size_t size;
+	int c;
+
+	if (!mem)
+		return;
+
+	if (malloc_use_classes()) {
+		size = tlsf_block_size(mem);
+		c = malloc_class_of(size);
+		if (c >= 0) {
+			/* the block may be bigger than its class, round down */
+			if (malloc_class_size[c] > size)
+				c--;
+		}
+
+		if (c >= 0 && malloc_classes[c].cached < MALLOC_CLASS_CACHE) {
+			mc = &malloc_classes[c];
+			*(void **)mem = mc->free;
+			mc->free = mem;
+			mc->cached++;
+			return;
+		}
+	}
+
 	tlsf_free(tlsf_mem_pool, mem);
 }
 EXPORT_SYMBOL(free);
@@ -50,6 +236,10 @@ EXPORT_SYMBOL(malloc_usable_size);
 void *realloc(void *oldmem, size_t bytes)
 {
 	void *mem = tlsf_realloc(tlsf_mem_pool, oldmem, bytes);
+	if (!mem && bytes && malloc_use_classes()) {
+		malloc_class_flush();
+		mem = tlsf_realloc(tlsf_mem_pool, oldmem, bytes);
+	}
 	if (!mem)
 		errno = ENOMEM;
 
@@ -60,6 +250,10 @@ EXPORT_SYMBOL(realloc);
 void *memalign(size_t alignment, size_t bytes)
 {
 	void *mem = tlsf_memalign(tlsf_mem_pool, alignment, bytes);
+	if (!mem && malloc_use_classes()) {
+		malloc_class_flush();
+		mem = tlsf_memalign(tlsf_mem_pool, alignment, bytes);
+	}
 	if (!mem)
 		errno = ENOMEM;
 
@@ -82,14 +276,68 @@ static void malloc_walker(void* ptr, size_t size, int used, void *user)
 		s->free += size;
 }
 
+#ifdef CONFIG_MALLOC_STATS
+static void malloc_stats_callers(void)
+{
+	struct malloc_caller *c, *top[16] = {};
+	unsigned int i, j;
+
+	for (c = malloc_callers; c < &malloc_callers[MALLOC_CALLERS]; c++) {
+		if (!c->ip)
+			continue;
+
+		for (i = 0; i < ARRAY_SIZE(top); i++) {
+			if (top[i] && top[i]->count >= c->count)
+				continue;
+
+			for (j = ARRAY_SIZE(top) - 1; j > i; j--)
+				top[j] = top[j - 1];
+			top[i] = c;
+			break;
+		}
+	}
+
+	printf("%10s %10s  %s\n", "allocs", "bytes", "caller");
+	for (i = 0; i < ARRAY_SIZE(top) && top[i]; i++)
+		printf("%10lu %10zu  %pS\n", top[i]->count, top[i]->bytes,
+		       (void *)top[i]->ip);
+
+	if (malloc_callers_lost)
+		printf("%lu allocations from untracked callers\n",
+		       malloc_callers_lost);
+}
+#else
+static inline void malloc_stats_callers(void)
+{
+}
+#endif
+
 void malloc_stats(void)
 {
 	struct malloc_stats s;
+	size_t cached = 0;
+	int i;
 
 	s.used = 0;
 	s.free = 0;
 
 	tlsf_walk_pool(tlsf_get_pool(tlsf_mem_pool), malloc_walker, &s);
 
-	printf("used: %zu\nfree: %zu\n", s.used, s.free);
+	for (i = 0; i < MALLOC_NUM_CLASSES; i++)
+		cached += malloc_classes[i].cached * malloc_class_size[i];
+
+	printf("used: %zu\nfree: %zu\n", s.used - cached, s.free + cached);
+
+	if (!malloc_use_classes())
+		return;
+
+	printf("%6s %10s %10s %6s\n", "class", "allocs", "cache hits", "cached");
+	for (i = 0; i < MALLOC_NUM_CLASSES; i++) {
+		struct malloc_class *mc = &malloc_classes[i];
+
+		printf("%6u %10lu %10lu %6u\n", malloc_class_size[i],
+		       mc->allocs, mc->hits, mc->cached);
+	}
+
+	malloc_stats_callers();
 }
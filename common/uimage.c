@@ -20,6 +20,7 @@
 #include <filetype.h>
 #include <memory.h>
 #include <zero_page.h>
+#include <boottrace.h>
 
 static inline int uimage_is_multi_image(struct uimage_handle *handle)
 {
@@ -77,6 +78,38 @@ ssize_t uimage_get_size(struct uimage_handle *handle, unsigned int image_no)
 }
 EXPORT_SYMBOL(uimage_get_size);
 
+/*
+ * If the uImage is backed by memory, remember the mapping so that the
+ * data can be verified and uncompressed in place instead of being
+ * read in chunks through the file descriptor.
+ */
+static void uimage_map(struct uimage_handle *handle)
+{
+	struct stat s;
+	size_t size;
+	void *map;
+
+	if (fstat(handle->fd, &s))
+		return;
+
+	size = sizeof(struct image_header) + handle->header.ih_size;
+	if (handle->nb_data_entries) {
+		struct uimage_handle_data *last;
+
+		last = &handle->ihd[handle->nb_data_entries - 1];
+		size = max(size, handle->data_offset + last->offset + last->len);
+	}
+
+	if (s.st_size == FILESIZE_MAX || s.st_size < size)
+		return;
+
+	map = memmap(handle->fd, PROT_READ);
+	if (map == MAP_FAILED || zero_page_contains((unsigned long)map))
+		return;
+
+	handle->map = map;
+}
+
 /*
  * open a uimage. This will check the header contents and
  * return a handle to the uImage
@@ -184,6 +217,8 @@ struct uimage_handle *uimage_open(const char *filename)
 	 */
 	handle->fd = fd;
 
+	uimage_map(handle);
+
 	return handle;
 err_out:
 	close(fd);
@@ -255,12 +290,20 @@ static int uncompress_copy(unsigned char *inbuf_unused, long len,
  */
 int uimage_verify(struct uimage_handle *handle)
 {
+	u64 start = boottrace_start();
 	u32 crc = 0;
 	int len, ret;
 	loff_t off;
 	void *buf;
 
 	off = sizeof(struct image_header);
+
+	if (handle->map) {
+		buf = NULL;
+		crc = crc32(0, handle->map + off, handle->header.ih_size);
+		goto check;
+	}
+
 	if (lseek(handle->fd, off, SEEK_SET) != off)
 		return -errno;
 
@@ -278,6 +321,7 @@ int uimage_verify(struct uimage_handle *handle)
 		len -= ret;
 	}
 
+check:
 	if (crc != handle->header.ih_dcrc) {
 		printf("Bad Data CRC: 0x%08x != 0x%08x\n",
 				crc, handle->header.ih_dcrc);
@@ -289,6 +333,8 @@ int uimage_verify(struct uimage_handle *handle)
 err:
 	free(buf);
 
+	boottrace_record("bootm", start, "verify %s", handle->name);
+
 	return ret;
 }
 EXPORT_SYMBOL(uimage_verify);
@@ -316,8 +362,6 @@ int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 	iha = &handle->ihd[image_no];
 
 	off = iha->offset + handle->data_offset;
-	if (lseek(handle->fd, off, SEEK_SET) != off)
-		return -errno;
 
 	/* if ramdisk U-Boot expect to ignore the compression type */
 	if (hdr->ih_comp == IH_COMP_NONE || hdr->ih_type == IH_TYPE_RAMDISK)
@@ -325,6 +369,21 @@ int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 	else
 		uncompress_fn = uncompress;
 
+	if (handle->map) {
+		unsigned char *inbuf = (unsigned char *)handle->map + off;
+
+		if (uncompress_fn == uncompress_copy) {
+			ret = flush(inbuf, iha->len);
+			return ret < 0 ? ret : 0;
+		}
+
+		return uncompress(inbuf, iha->len, NULL, flush, NULL, NULL,
+				  uncompress_err_stdout);
+	}
+
+	if (lseek(handle->fd, off, SEEK_SET) != off)
+		return -errno;
+
 	uimage_fd = handle->fd;
 
 	ret = uncompress_fn(NULL, iha->len, uimage_fill, flush,
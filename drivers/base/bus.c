@@ -7,6 +7,7 @@
 #include <driver.h>
 #include <errno.h>
 #include <of.h>
+#include <string.h>
 
 LIST_HEAD(bus_list);
 EXPORT_SYMBOL(bus_list);
@@ -47,6 +48,161 @@ int bus_register(struct bus_type *bus)
 	return 0;
 }
 
+/*
+ * For buses matching with device_match(), devices with a device tree node
+ * only bind to drivers with a compatible in common or to drivers without
+ * any of_compatible table. Index the compatibles of all drivers of such
+ * buses, so binding a device doesn't need to compare it against every
+ * registered driver.
+ */
+#define BUS_MATCH_INDEX_BITS	8
+#define BUS_MATCH_INDEX_SIZE	(1 << BUS_MATCH_INDEX_BITS)
+/* extra bucket for drivers without of_compatible table */
+#define BUS_MATCH_INDEX_ANY	BUS_MATCH_INDEX_SIZE
+
+struct bus_match_entry {
+	struct hlist_node node;
+	u32 hash;
+	const char *compatible;
+	struct driver *drv;
+};
+
+static bool bus_match_indexed(struct bus_type *bus)
+{
+	return IS_ENABLED(CONFIG_DRIVER_MATCH_INDEX) &&
+		bus->match == device_match;
+}
+
+static void bus_match_index_insert(struct bus_type *bus, struct driver *drv,
+				   const char *compatible)
+{
+	struct bus_match_entry *e = xzalloc(sizeof(*e));
+	unsigned int bucket = BUS_MATCH_INDEX_ANY;
+
+	e->drv = drv;
+	e->compatible = compatible;
+
+	if (compatible) {
+		e->hash = strcasehash(compatible);
+		bucket = e->hash & (BUS_MATCH_INDEX_SIZE - 1);
+	}
+
+	hlist_add_head(&e->node, &bus->match_index[bucket]);
+}
+
+/**
+ * bus_match_index_add - add a newly registered driver to the match index
+ * @drv: The driver
+ */
+void bus_match_index_add(struct driver *drv)
+{
+	struct bus_type *bus = drv->bus;
+	const struct of_device_id *id;
+
+	drv->bus_seq = bus->driver_seq++;
+
+	if (!bus_match_indexed(bus))
+		return;
+
+	if (!bus->match_index)
+		bus->match_index = xzalloc((BUS_MATCH_INDEX_SIZE + 1) *
+					   sizeof(*bus->match_index));
+
+	if (!drv->of_compatible) {
+		bus_match_index_insert(bus, drv, NULL);
+		return;
+	}
+
+	for (id = drv->of_compatible; id->compatible; id++)
+		bus_match_index_insert(bus, drv, id->compatible);
+}
+
+/**
+ * bus_match_index_del - remove a driver from the match index
+ * @drv: The driver
+ */
+void bus_match_index_del(struct driver *drv)
+{
+	struct bus_type *bus = drv->bus;
+	struct bus_match_entry *e;
+	struct hlist_node *tmp;
+	int i;
+
+	if (!bus->match_index)
+		return;
+
+	for (i = 0; i <= BUS_MATCH_INDEX_SIZE; i++) {
+		hlist_for_each_entry_safe(e, tmp, &bus->match_index[i], node) {
+			if (e->drv != drv)
+				continue;
+			hlist_del(&e->node);
+			free(e);
+		}
+	}
+}
+
+static int bus_match_candidate_add(struct driver **drvs, int n, int max,
+				   struct driver *drv)
+{
+	int i;
+
+	/* keep registration order, that's the order drivers are tried in */
+	for (i = n; i > 0 && drvs[i - 1]->bus_seq >= drv->bus_seq; i--)
+		if (drvs[i - 1] == drv)
+			return n;
+
+	if (n == max)
+		return -ENOSPC;
+
+	memmove(&drvs[i + 1], &drvs[i], (n - i) * sizeof(*drvs));
+	drvs[i] = drv;
+
+	return n + 1;
+}
+
+/**
+ * bus_match_candidates - collect the drivers a device may bind to
+ * @dev: The device
+ * @drvs: array to fill
+ * @max: size of @drvs
+ *
+ * Return: number of candidate drivers in @drvs, in registration order,
+ * or a negative error code if the index can't be used for @dev and all
+ * drivers of the bus must be tried.
+ */
+int bus_match_candidates(struct device *dev, struct driver **drvs, int max)
+{
+	struct bus_type *bus = dev->bus;
+	struct bus_match_entry *e;
+	const struct property *prop;
+	const char *compat;
+	int n = 0;
+
+	if (!bus_match_indexed(bus) || !bus->match_index || !dev->of_node)
+		return -ENOSYS;
+
+	of_property_for_each_string(dev->of_node, "compatible", prop, compat) {
+		u32 hash = strcasehash(compat);
+
+		hlist_for_each_entry(e, &bus->match_index[hash & (BUS_MATCH_INDEX_SIZE - 1)], node) {
+			if (e->hash != hash || of_compat_cmp(e->compatible, compat, 0))
+				continue;
+
+			n = bus_match_candidate_add(drvs, n, max, e->drv);
+			if (n < 0)
+				return n;
+		}
+	}
+
+	hlist_for_each_entry(e, &bus->match_index[BUS_MATCH_INDEX_ANY], node) {
+		n = bus_match_candidate_add(drvs, n, max, e->drv);
+		if (n < 0)
+			return n;
+	}
+
+	return n;
+}
+
 int device_match(struct device *dev, struct driver *drv)
 {
 	if (IS_ENABLED(CONFIG_OFDEVICE) && dev->of_node &&
@@ -30,6 +30,8 @@
 #include <pinctrl.h>
 #include <featctrl.h>
 #include <linux/clk/clk-conf.h>
+#include <boottrace.h>
+#include <initcall_report.h>
 
 #ifdef CONFIG_DEBUG_PROBES
 #define pr_report_probe		pr_info
@@ -47,6 +49,17 @@ LIST_HEAD(active_device_list);
 EXPORT_SYMBOL(active_device_list);
 static LIST_HEAD(deferred);
 
+/* The device currently being probed */
+static struct device *probing_dev;
+/* Number of successful probes, used to skip useless deferred probe retries */
+static unsigned int device_bind_count;
+
+static struct {
+	unsigned int passes;
+	unsigned int retries;
+	unsigned int skipped;
+} deferred_stats;
+
 static LIST_HEAD(device_alias_list);
 
 struct device *find_device(const char *str)
@@ -118,6 +131,8 @@ static void dev_report_permanent_probe_deferral(struct device *dev)
 int device_probe(struct device *dev)
 {
 	static int depth = 0;
+	struct device *parent;
+	u64 start;
 	int ret;
 
 	ret = of_feature_controller_check(dev->of_node);
@@ -137,6 +152,12 @@ int device_probe(struct device *dev)
 
 	list_add(&dev->active, &active_device_list);
 
+	start = boottrace_start();
+
+	parent = probing_dev;
+	probing_dev = dev;
+	dev->deferred_supplier = NULL;
+
 	if (dev->bus->probe)
 		ret = dev->bus->probe(dev);
 	else if (dev->driver->probe)
@@ -144,10 +165,15 @@ int device_probe(struct device *dev)
 	else
 		ret = 0;
 
+	probing_dev = parent;
+
+	boottrace_record("probe", start, "%s", dev_name(dev));
+
 	depth--;
 
 	switch (ret) {
 	case 0:
+		device_bind_count++;
 		return 0;
 	case -EPROBE_DEFER:
 		/*
@@ -161,7 +187,14 @@ int device_probe(struct device *dev)
 
 		list_move(&dev->active, &deferred);
 
-		dev_dbg(dev, "probe deferred\n");
+		dev->deferred_bind_count = device_bind_count;
+		dev->deferred_count++;
+
+		if (dev->deferred_supplier)
+			dev_dbg(dev, "probe deferred, waiting for %pOF\n",
+				dev->deferred_supplier);
+		else
+			dev_dbg(dev, "probe deferred\n");
 		return -EPROBE_DEFER;
 	case -ENODEV:
 	case -ENXIO:
@@ -238,10 +271,33 @@ static int match(struct driver *drv, struct device *dev)
 	return -1;
 }
 
-int register_device(struct device *new_device)
+/* enough for the drivers sharing a compatible plus those without any */
+#define DEVICE_BIND_CANDIDATES	32
+
+static int device_bind(struct device *dev)
 {
+	struct driver *drvs[DEVICE_BIND_CANDIDATES];
 	struct driver *drv;
+	int i, n;
 
+	n = bus_match_candidates(dev, drvs, ARRAY_SIZE(drvs));
+	if (n >= 0) {
+		for (i = 0; i < n; i++)
+			if (!match(drvs[i], dev))
+				return 0;
+		return -ENODEV;
+	}
+
+	bus_for_each_driver(dev->bus, drv) {
+		if (!match(drv, dev))
+			return 0;
+	}
+
+	return -ENODEV;
+}
+
+int register_device(struct device *new_device)
+{
 	if (new_device->id == DEVICE_ID_DYNAMIC) {
 		new_device->id = get_free_deviceid(new_device->name);
 	} else {
@@ -272,10 +328,7 @@ int register_device(struct device *new_device)
 
 		list_add_tail(&new_device->bus_list, &new_device->bus->device_list);
 
-		bus_for_each_driver(new_device->bus, drv) {
-			if (!match(drv, new_device))
-				break;
-		}
+		device_bind(new_device);
 	}
 
 	if (new_device->parent)
@@ -363,6 +416,73 @@ void free_device(struct device *dev)
 }
 EXPORT_SYMBOL(free_device);
 
+/**
+ * device_defer_on - record the supplier a device waits for
+ * @supplier: device node of the missing supplier
+ *
+ * Called by the resource lookup functions (clocks, GPIOs, regulators,
+ * PHYs) before they return -EPROBE_DEFER. If the currently probing
+ * device defers its probe, it is only retried once @supplier is bound.
+ */
+void device_defer_on(struct device_node *supplier)
+{
+	if (probing_dev && !probing_dev->deferred_supplier)
+		probing_dev->deferred_supplier = supplier;
+}
+EXPORT_SYMBOL(device_defer_on);
+
+/*
+ * Check if a supplier a device waits for might be available now. Suppliers
+ * are often subnodes of the device providing them (regulators of a PMIC,
+ * GPIO banks), so look for the closest device in the node hierarchy. If
+ * there is none we can't tell and have to retry.
+ */
+static bool device_supplier_maybe_ready(struct device_node *np)
+{
+	for (; np; np = np->parent) {
+		if (np->dev)
+			return np->dev->driver != NULL;
+	}
+
+	return true;
+}
+
+/*
+ * Retry the deferred devices. With @use_hints devices are skipped if no
+ * device has been bound since they deferred or if the supplier they are
+ * waiting for is still missing.
+ */
+static bool device_probe_deferred_pass(bool use_hints)
+{
+	struct device *dev, *tmp;
+	bool success = false;
+	u64 start = boottrace_start();
+
+	deferred_stats.passes++;
+
+	list_for_each_entry_safe(dev, tmp, &deferred, active) {
+		if (use_hints &&
+		    (dev->deferred_bind_count == device_bind_count ||
+		     !device_supplier_maybe_ready(dev->deferred_supplier))) {
+			deferred_stats.skipped++;
+			continue;
+		}
+
+		list_del(&dev->active);
+		INIT_LIST_HEAD(&dev->active);
+
+		deferred_stats.retries++;
+
+		dev_dbg(dev, "re-probe device\n");
+		if (!device_bind(dev))
+			success = true;
+	}
+
+	boottrace_record("deferred", start, "deferred probe pass");
+
+	return success;
+}
+
 /*
  * Loop over list of deferred devices as long as at least one
  * device is successfully probed. Devices that again request
@@ -372,37 +492,52 @@ EXPORT_SYMBOL(free_device);
  */
 static int device_probe_deferred(void)
 {
-	struct device *dev, *tmp;
-	struct driver *drv;
-	bool success;
-
-	do {
-		success = false;
-
-		if (list_empty(&deferred))
-			return 0;
+	struct device *dev;
 
-		list_for_each_entry_safe(dev, tmp, &deferred, active) {
-			list_del(&dev->active);
-			INIT_LIST_HEAD(&dev->active);
+	if (list_empty(&deferred))
+		return 0;
 
-			dev_dbg(dev, "re-probe device\n");
-			bus_for_each_driver(dev->bus, drv) {
-				if (match(drv, dev))
-					continue;
-				success = true;
-				break;
-			}
-		}
-	} while (success);
+	/*
+	 * First retry only the devices whose suppliers showed up. The hints
+	 * may be incomplete, so finish with full passes until nothing
+	 * changes anymore, like we always did.
+	 */
+	do {
+		while (!list_empty(&deferred) && device_probe_deferred_pass(true))
+			;
+	} while (!list_empty(&deferred) && device_probe_deferred_pass(false));
 
 	list_for_each_entry(dev, &deferred, active)
 		dev_report_permanent_probe_deferral(dev);
 
+	pr_report_probe("deferred probe: %u passes, %u retries, %u skipped\n",
+			deferred_stats.passes, deferred_stats.retries,
+			deferred_stats.skipped);
+
 	return 0;
 }
 late_initcall(device_probe_deferred);
 
+void device_print_deferred_stats(void)
+{
+	struct device *dev;
+
+	if (!deferred_stats.passes)
+		return;
+
+	printf("\nDeferred probing: %u passes, %u retries, %u skipped\n",
+	       deferred_stats.passes, deferred_stats.retries,
+	       deferred_stats.skipped);
+
+	for_each_device(dev) {
+		if (!dev->deferred_count)
+			continue;
+
+		printf("  %s: deferred %u times%s\n", dev_name(dev),
+		       dev->deferred_count, dev->driver ? "" : ", not bound");
+	}
+}
+
 struct driver *get_driver_by_name(const char *name)
 {
 	struct driver *drv;
@@ -418,6 +553,8 @@ struct driver *get_driver_by_name(const char *name)
 int register_driver(struct driver *drv)
 {
 	struct device *dev = NULL;
+	u64 start = initcall_report_start();
+	unsigned int tried = 0;
 
 	if (!drv->name)
 		return -EINVAL;
@@ -428,9 +565,15 @@ int register_driver(struct driver *drv)
 
 	list_add_tail(&drv->list, &driver_list);
 	list_add_tail(&drv->bus_list, &drv->bus->driver_list);
+	bus_match_index_add(drv);
 
-	bus_for_each_device(drv->bus, dev)
+	bus_for_each_device(drv->bus, dev) {
+		if (!dev->driver)
+			tried++;
 		match(drv, dev);
+	}
+
+	driver_report_record(drv, start, tried);
 
 	return 0;
 }
@@ -442,6 +585,7 @@ void unregister_driver(struct driver *drv)
 
 	list_del(&drv->list);
 	list_del(&drv->bus_list);
+	bus_match_index_del(drv);
 
 	bus_for_each_device(drv->bus, dev) {
 		if (dev->driver == drv) {
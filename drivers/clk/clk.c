@@ -776,6 +776,9 @@ struct clk *of_clk_get_from_provider(struct of_phandle_args *clkspec)
 			break;
 	}
 
+	if (clk == ERR_PTR(-EPROBE_DEFER))
+		device_defer_on(clkspec->np);
+
 	return clk;
 }
 
@@ -168,6 +168,7 @@ int nand_isbad_bbt(struct nand_chip *chip, loff_t offs, int allowbbt);
 /* Legacy */
 void nand_legacy_set_defaults(struct nand_chip *chip);
 void nand_legacy_adjust_cmdfunc(struct nand_chip *chip);
+bool nand_legacy_has_cont_read(struct nand_chip *chip);
 int nand_legacy_check_hooks(struct nand_chip *chip);
 
 /* ONFI functions */
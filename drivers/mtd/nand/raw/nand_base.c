@@ -1166,6 +1166,19 @@ static void rawnand_cap_cont_reads(struct nand_chip *chip)
 		chip->cont_read.ongoing = false;
 }
 
+static void rawnand_cont_read_page_done(struct nand_chip *chip, unsigned int page)
+{
+	if (!chip->cont_read.ongoing)
+		return;
+
+	if (page == chip->cont_read.last_page) {
+		chip->cont_read.ongoing = false;
+	} else if (page == chip->cont_read.pause_page) {
+		chip->cont_read.first_page++;
+		rawnand_cap_cont_reads(chip);
+	}
+}
+
 static int nand_lp_exec_cont_read_page_op(struct nand_chip *chip, unsigned int page,
 					  unsigned int offset_in_page, void *buf,
 					  unsigned int len, bool check_only)
@@ -1227,16 +1240,33 @@ static int nand_lp_exec_cont_read_page_op(struct nand_chip *chip, unsigned int p
 	if (ret)
 		return ret;
 
-	if (!chip->cont_read.ongoing)
-		return 0;
+	rawnand_cont_read_page_done(chip, page);
 
-	if (page == chip->cont_read.last_page) {
-		chip->cont_read.ongoing = false;
+	return 0;
+}
+
+static int nand_lp_legacy_cont_read_page_op(struct nand_chip *chip,
+					    unsigned int page,
+					    unsigned int offset_in_page,
+					    void *buf, unsigned int len)
+{
+	unsigned int command;
+
+	if (page == chip->cont_read.first_page) {
+		chip->legacy.cmdfunc(chip, NAND_CMD_READ0, offset_in_page, page);
+		command = NAND_CMD_READCACHESEQ;
 	} else if (page == chip->cont_read.pause_page) {
-		chip->cont_read.first_page++;
-		rawnand_cap_cont_reads(chip);
+		command = NAND_CMD_READCACHEEND;
+	} else {
+		command = NAND_CMD_READCACHESEQ;
 	}
 
+	chip->legacy.cmdfunc(chip, command, -1, -1);
+	if (len)
+		chip->legacy.read_buf(chip, buf, len);
+
+	rawnand_cont_read_page_done(chip, page);
+
 	return 0;
 }
 
@@ -1285,6 +1315,11 @@ int nand_read_page_op(struct nand_chip *chip, unsigned int page,
 						 buf, len);
 	}
 
+	if (rawnand_cont_read_ongoing(chip, page))
+		return nand_lp_legacy_cont_read_page_op(chip, page,
+							offset_in_page,
+							buf, len);
+
 	chip->legacy.cmdfunc(chip, NAND_CMD_READ0, offset_in_page, page);
 	if (len)
 		chip->legacy.read_buf(chip, buf, len);
@@ -5072,6 +5107,17 @@ static void rawnand_check_cont_read_support(struct nand_chip *chip)
 	if (chip->read_retries)
 		return;
 
+	if (!nand_has_exec_op(chip)) {
+		/*
+		 * Legacy controllers can only do sequential cache reads when
+		 * they use the core command function, which knows how to wait
+		 * for the cache register to be loaded.
+		 */
+		if (nand_legacy_has_cont_read(chip))
+			chip->controller->supported_op.cont_read = 1;
+		return;
+	}
+
 	if (!nand_lp_exec_cont_read_page_op(chip, 0, 0, NULL,
 					    mtd->writesize, true))
 		chip->controller->supported_op.cont_read = 1;
@@ -5090,9 +5136,6 @@ static void rawnand_late_check_supported_ops(struct nand_chip *chip)
 	if (chip->ecc.engine_type == NAND_ECC_ENGINE_TYPE_ON_DIE)
 		return;
 
-	if (!nand_has_exec_op(chip))
-		return;
-
 	/*
 	 * For now, continuous reads can only be used with the core page helpers.
 	 * This can be extended later.
@@ -117,6 +117,9 @@ int nand_jedec_detect(struct nand_chip *chip)
 	if (le16_to_cpu(p->features) & JEDEC_FEATURE_16_BIT_BUS)
 		chip->options |= NAND_BUSWIDTH_16;
 
+	if (p->opt_cmd[0] & JEDEC_OPT_CMD_READ_CACHE)
+		chip->parameters.supports_read_cache = true;
+
 	/* ECC info */
 	ecc = &p->ecc_info[0];
 
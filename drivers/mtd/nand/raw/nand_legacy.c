@@ -605,6 +605,16 @@ void nand_legacy_adjust_cmdfunc(struct nand_chip *chip)
 		chip->legacy.cmdfunc = nand_command_lp;
 }
 
+/*
+ * The core large page command function issues READCACHESEQ and READCACHEEND
+ * like any other command without address cycles and then waits for the chip
+ * to become ready again, which is all a sequential cache read needs.
+ */
+bool nand_legacy_has_cont_read(struct nand_chip *chip)
+{
+	return chip->legacy.cmdfunc == nand_command_lp;
+}
+
 int nand_legacy_check_hooks(struct nand_chip *chip)
 {
 	/*
@@ -938,7 +938,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	struct ubi_vid_io_buf *vidb = ai->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, vid_err, bitflips = 0, vol_id = -1, ec_err = 0;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -951,7 +951,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = ubi_io_read_hdrs(ubi, pnum, ech, vidb, &vid_err);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1032,9 +1032,14 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		}
 	}
 
-	/* OK, we've done with the EC header, let's look at the VID header */
+	/*
+	 * OK, we've done with the EC header, let's look at the VID header. It
+	 * usually has been read along with the EC header already.
+	 */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	err = vid_err;
+	if (err == -EAGAIN)
+		err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
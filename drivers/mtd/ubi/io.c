@@ -427,52 +427,21 @@ static int validate_ec_hdr(const struct ubi_device *ubi,
 }
 
 /**
- * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * check_ec_hdr - check an erase counter header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock to read from
- * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
- * header
+ * @pnum: physical eraseblock the header was read from
+ * @ec_hdr: the erase counter header to check
+ * @read_err: the return value of the read operation
  * @verbose: be verbose if the header is corrupted or was not found
  *
- * This function reads erase counter header from physical eraseblock @pnum and
- * stores it in @ec_hdr. This function also checks CRC checksum of the read
- * erase counter header. The following codes may be returned:
- *
- * o %0 if the CRC checksum is correct and the header was successfully read;
- * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
- *   and corrected by the flash driver; this is harmless but may indicate that
- *   this eraseblock may become bad soon (but may be not);
- * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
- * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
- *   a data integrity error (uncorrectable ECC error in case of NAND);
- * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
- * o a negative error code in case of failure.
+ * Returns the same codes as 'ubi_io_read_ec_hdr()'.
  */
-int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
-		       struct ubi_ec_hdr *ec_hdr, int verbose)
+static int check_ec_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 
-	dbg_io("read EC header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
-	if (read_err) {
-		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-			return read_err;
-
-		/*
-		 * We read all the data, but either a correctable bit-flip
-		 * occurred, or MTD reported a data integrity error
-		 * (uncorrectable ECC error in case of NAND). The former is
-		 * harmless, the later may mean that the read data is
-		 * corrupted. But we have a CRC check-sum and we will detect
-		 * this. If the EC header is still OK, we just report this as
-		 * there was a bit-flip, to force scrubbing.
-		 */
-	}
-
 	magic = be32_to_cpu(ec_hdr->magic);
 	if (magic != UBI_EC_HDR_MAGIC) {
 		if (mtd_is_eccerr(read_err))
@@ -542,6 +511,55 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
+ * header
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function reads erase counter header from physical eraseblock @pnum and
+ * stores it in @ec_hdr. This function also checks CRC checksum of the read
+ * erase counter header. The following codes may be returned:
+ *
+ * o %0 if the CRC checksum is correct and the header was successfully read;
+ * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
+ *   and corrected by the flash driver; this is harmless but may indicate that
+ *   this eraseblock may become bad soon (but may be not);
+ * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
+ * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
+ *   a data integrity error (uncorrectable ECC error in case of NAND);
+ * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
+ * o a negative error code in case of failure.
+ */
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
+		       struct ubi_ec_hdr *ec_hdr, int verbose)
+{
+	int read_err;
+
+	dbg_io("read EC header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	if (read_err) {
+		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+			return read_err;
+
+		/*
+		 * We read all the data, but either a correctable bit-flip
+		 * occurred, or MTD reported a data integrity error
+		 * (uncorrectable ECC error in case of NAND). The former is
+		 * harmless, the later may mean that the read data is
+		 * corrupted. But we have a CRC check-sum and we will detect
+		 * this. If the EC header is still OK, we just report this as
+		 * there was a bit-flip, to force scrubbing.
+		 */
+	}
+
+	return check_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
 /**
  * ubi_io_write_ec_hdr - write an erase counter header.
  * @ubi: UBI device description object
@@ -708,35 +726,21 @@ static int validate_vid_hdr(const struct ubi_device *ubi,
 }
 
 /**
- * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * check_vid_hdr - check a volume identifier header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock number to read from
- * @vidb: the volume identifier buffer to store data in
+ * @pnum: physical eraseblock the header was read from
+ * @vidb: the volume identifier buffer holding the header
+ * @read_err: the return value of the read operation
  * @verbose: be verbose if the header is corrupted or wasn't found
  *
- * This function reads the volume identifier header from physical eraseblock
- * @pnum and stores it in @vidb. It also checks CRC checksum of the read
- * volume identifier header. The error codes are the same as in
- * 'ubi_io_read_ec_hdr()'.
- *
- * Note, the implementation of this function is also very similar to
- * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ * Returns the same codes as 'ubi_io_read_vid_hdr()'.
  */
-int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
-			struct ubi_vid_io_buf *vidb, int verbose)
+static int check_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_io_buf *vidb, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 	struct ubi_vid_hdr *vid_hdr = ubi_get_vid_hdr(vidb);
-	void *p = vidb->buffer;
-
-	dbg_io("read VID header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
-			  ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
-	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-		return read_err;
 
 	magic = be32_to_cpu(vid_hdr->magic);
 	if (magic != UBI_VID_HDR_MAGIC) {
@@ -791,6 +795,88 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @vidb: the volume identifier buffer to store data in
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function reads the volume identifier header from physical eraseblock
+ * @pnum and stores it in @vidb. It also checks CRC checksum of the read
+ * volume identifier header. The error codes are the same as in
+ * 'ubi_io_read_ec_hdr()'.
+ *
+ * Note, the implementation of this function is also very similar to
+ * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ */
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_io_buf *vidb, int verbose)
+{
+	int read_err;
+
+	dbg_io("read VID header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, vidb->buffer, pnum, ubi->vid_hdr_aloffset,
+			  ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
+	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+		return read_err;
+
+	return check_vid_hdr(ubi, pnum, vidb, read_err, verbose);
+}
+
+/**
+ * ubi_io_read_hdrs - read and check both UBI headers with a single read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the erase counter header
+ * @vidb: the volume identifier buffer to store the VID header in
+ * @vid_err: where to store the result of the VID header check
+ *
+ * This function is used when attaching by scanning. With the default header
+ * layout the VID header directly follows the EC header, so both headers are
+ * fetched with one read operation instead of two. On NAND this saves a page
+ * read command per PEB, or allows the driver to serve both pages with a single
+ * cache read sequence.
+ *
+ * Returns the same codes as 'ubi_io_read_ec_hdr()' for the EC header, the
+ * result of checking the VID header is stored in @vid_err. If the headers do
+ * not follow each other, or if the read reported bit-flips or ECC errors,
+ * only the EC header is read and checked and @vid_err is set to %-EAGAIN. The
+ * caller then has to read the VID header with 'ubi_io_read_vid_hdr()'. This
+ * makes sure that read errors are attributed to the right header.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_io_buf *vidb,
+		     int *vid_err)
+{
+	int err, len = ubi->vid_hdr_offset + UBI_VID_HDR_SIZE;
+	void *buf = ubi->peb_buf;
+
+	dbg_io("read EC and VID headers from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	*vid_err = -EAGAIN;
+
+	if (ubi->vid_hdr_aloffset != ubi->ec_hdr_alsize)
+		return ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+
+	err = ubi_io_read(ubi, buf, pnum, 0, len);
+	if (err)
+		return ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+
+	memcpy(ec_hdr, buf, UBI_EC_HDR_SIZE);
+	memcpy(vidb->buffer, buf + ubi->vid_hdr_aloffset,
+	       ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
+
+	err = check_ec_hdr(ubi, pnum, ec_hdr, 0, 0);
+	if (err != UBI_IO_FF)
+		*vid_err = check_vid_hdr(ubi, pnum, vidb, 0, 0);
+
+	return err;
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
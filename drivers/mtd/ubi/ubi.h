@@ -874,6 +874,9 @@ int ubi_io_write_ec_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_ec_hdr *ec_hdr);
 int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_io_buf *vidb, int verbose);
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_io_buf *vidb,
+		     int *vid_err);
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_io_buf *vidb);
 
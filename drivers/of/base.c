@@ -18,10 +18,14 @@
 #include <of_graph.h>
 #include <string.h>
 #include <libfile.h>
+#include <qsort.h>
+#include <linux/bsearch.h>
 #include <linux/clk.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
 
+#include "of_private.h"
+
 static struct device_node *root_node;
 
 /**
@@ -344,6 +348,243 @@ struct device_node *of_find_node_by_alias(struct device_node *root, const char *
 }
 EXPORT_SYMBOL_GPL(of_find_node_by_alias);
 
+/*
+ * Lookup acceleration for the device tree
+ *
+ * Looking up nodes by phandle or compatible normally requires walking the
+ * whole tree, which is done many thousand times while probing a large
+ * board. With CONFIG_OF_LOOKUP_INDEX phandle lookups go through a small
+ * cache whose entries are validated on every hit, so that stale entries
+ * only cause a miss. Compatible lookups in the live tree use a sorted index
+ * that is rebuilt lazily after the compatible properties or nodes of the
+ * live tree have changed.
+ */
+#define OF_PHANDLE_CACHE_SIZE	256
+
+static struct device_node *of_phandle_cache[OF_PHANDLE_CACHE_SIZE];
+
+struct of_compat_entry {
+	const char *compatible;
+	unsigned int seq;
+};
+
+struct of_node_entry {
+	struct device_node *np;
+	unsigned int seq;
+};
+
+static struct of_compat_index {
+	bool valid;
+	struct of_compat_entry *compats;
+	unsigned int num_compats;
+	/* nodes in tree order */
+	struct device_node **nodes;
+	/* nodes sorted by address to find the position of a node */
+	struct of_node_entry *by_addr;
+	unsigned int num_nodes;
+} of_compat_index;
+
+static struct of_lookup_stats {
+	unsigned long phandle_hits;
+	unsigned long phandle_walks;
+	unsigned long compatible_hits;
+	unsigned long compatible_walks;
+	unsigned long compatible_rebuilds;
+} of_lookup_stats;
+
+static void of_phandle_cache_remove(struct device_node *node)
+{
+	int i;
+
+	for (i = 0; i < OF_PHANDLE_CACHE_SIZE; i++)
+		if (of_phandle_cache[i] == node)
+			of_phandle_cache[i] = NULL;
+}
+
+static void of_compat_index_invalidate(void)
+{
+	struct of_compat_index *idx = &of_compat_index;
+
+	if (!idx->valid)
+		return;
+
+	free(idx->compats);
+	free(idx->nodes);
+	free(idx->by_addr);
+	memset(idx, 0, sizeof(*idx));
+}
+
+/*
+ * Called whenever a compatible property or a node is added or removed. Only
+ * changes to the live tree invalidate the index.
+ */
+static void of_compat_index_changed(struct device_node *node)
+{
+	if (!of_compat_index.valid)
+		return;
+
+	if (!node || of_find_root_node(node) == root_node)
+		of_compat_index_invalidate();
+}
+
+static bool of_prop_is_compatible(const char *name)
+{
+	return !of_prop_cmp(name, "compatible");
+}
+
+static int of_compat_entry_cmp(const void *a, const void *b)
+{
+	const struct of_compat_entry *ca = a, *cb = b;
+	int ret;
+
+	ret = of_compat_cmp(ca->compatible, cb->compatible, 0);
+	if (ret)
+		return ret;
+
+	return ca->seq < cb->seq ? -1 : ca->seq > cb->seq;
+}
+
+static int of_node_entry_cmp(const void *a, const void *b)
+{
+	const struct of_node_entry *na = a, *nb = b;
+
+	if (na->np == nb->np)
+		return 0;
+
+	return na->np < nb->np ? -1 : 1;
+}
+
+static int of_compat_index_build(void)
+{
+	struct of_compat_index *idx = &of_compat_index;
+	struct device_node *np;
+	struct property *prop;
+	const char *cp;
+	unsigned int n = 0, c = 0;
+
+	if (idx->valid)
+		return 0;
+
+	if (!root_node)
+		return -ENOENT;
+
+	of_tree_for_each_node_from(np, NULL) {
+		prop = of_find_property(np, "compatible", NULL);
+		for (cp = of_prop_next_string(prop, NULL); cp;
+		     cp = of_prop_next_string(prop, cp))
+			c++;
+		n++;
+	}
+
+	idx->compats = malloc(c * sizeof(*idx->compats));
+	idx->nodes = malloc(n * sizeof(*idx->nodes));
+	idx->by_addr = malloc(n * sizeof(*idx->by_addr));
+	if ((c && !idx->compats) || !idx->nodes || !idx->by_addr) {
+		idx->valid = true;
+		of_compat_index_invalidate();
+		return -ENOMEM;
+	}
+
+	n = 0;
+	c = 0;
+
+	of_tree_for_each_node_from(np, NULL) {
+		prop = of_find_property(np, "compatible", NULL);
+		for (cp = of_prop_next_string(prop, NULL); cp;
+		     cp = of_prop_next_string(prop, cp)) {
+			idx->compats[c].compatible = cp;
+			idx->compats[c].seq = n;
+			c++;
+		}
+
+		idx->nodes[n] = np;
+		idx->by_addr[n].np = np;
+		idx->by_addr[n].seq = n;
+		n++;
+	}
+
+	qsort(idx->compats, c, sizeof(*idx->compats), of_compat_entry_cmp);
+	qsort(idx->by_addr, n, sizeof(*idx->by_addr), of_node_entry_cmp);
+
+	idx->num_compats = c;
+	idx->num_nodes = n;
+	idx->valid = true;
+
+	of_lookup_stats.compatible_rebuilds++;
+
+	return 0;
+}
+
+/*
+ * Return the position in the live tree from which a search starting after
+ * @from begins, or -ENOENT if @from isn't part of the index.
+ */
+static int of_compat_index_start(struct device_node *from)
+{
+	struct of_compat_index *idx = &of_compat_index;
+	struct of_node_entry key = { .np = from }, *e;
+
+	if (!IS_ENABLED(CONFIG_OF_LOOKUP_INDEX) || of_compat_index_build())
+		return -ENOENT;
+
+	if (!from)
+		return 0;
+
+	e = bsearch(&key, idx->by_addr, idx->num_nodes, sizeof(*e),
+		    of_node_entry_cmp);
+	if (!e)
+		return -ENOENT;
+
+	return e->seq + 1;
+}
+
+/*
+ * Find the position of the first node at or after @start which has
+ * @compatible in its compatible list, or -ENOENT if there is none.
+ */
+static int of_compat_index_find(const char *compatible, unsigned int start)
+{
+	struct of_compat_index *idx = &of_compat_index;
+	struct of_compat_entry key = {
+		.compatible = compatible,
+		.seq = start,
+	};
+	unsigned int lo = 0, hi = idx->num_compats, mid;
+	struct of_compat_entry *e;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (of_compat_entry_cmp(&idx->compats[mid], &key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == idx->num_compats)
+		return -ENOENT;
+
+	e = &idx->compats[lo];
+	if (of_compat_cmp(e->compatible, compatible, 0))
+		return -ENOENT;
+
+	return e->seq;
+}
+
+void of_lookup_stats_print(void)
+{
+	struct of_lookup_stats *s = &of_lookup_stats;
+
+	printf("phandle lookups:    %lu cached, %lu tree walks\n",
+	       s->phandle_hits, s->phandle_walks);
+	printf("compatible lookups: %lu indexed, %lu tree walks\n",
+	       s->compatible_hits, s->compatible_walks);
+	printf("compatible index:   %u nodes, %u entries, %lu rebuilds\n",
+	       of_compat_index.num_nodes, of_compat_index.num_compats,
+	       s->compatible_rebuilds);
+	printf("tree walks avoided: %lu\n",
+	       s->phandle_hits + s->compatible_hits);
+}
+
 /*
  * of_find_node_by_phandle_from - Find a node given a phandle from given
  * root node.
@@ -354,11 +595,28 @@ EXPORT_SYMBOL_GPL(of_find_node_by_alias);
 struct device_node *of_find_node_by_phandle_from(phandle phandle,
 		struct device_node *root)
 {
-	struct device_node *node;
+	struct device_node *node, **slot = NULL;
+
+	if (IS_ENABLED(CONFIG_OF_LOOKUP_INDEX) && phandle &&
+	    (!root || !root->parent)) {
+		slot = &of_phandle_cache[phandle % OF_PHANDLE_CACHE_SIZE];
+		node = *slot;
+
+		if (node && node->phandle == phandle && node != root &&
+		    of_find_root_node(node) == (root ?: root_node)) {
+			of_lookup_stats.phandle_hits++;
+			return node;
+		}
+	}
+
+	of_lookup_stats.phandle_walks++;
 
 	of_tree_for_each_node_from(node, root)
-		if (node->phandle == phandle)
+		if (node->phandle == phandle) {
+			if (slot)
+				*slot = node;
 			return node;
+		}
 
 	return NULL;
 }
@@ -660,6 +918,17 @@ struct device_node *of_find_compatible_node(struct device_node *from,
 	const char *type, const char *compatible)
 {
 	struct device_node *np;
+	int start, seq;
+
+	start = of_compat_index_start(from);
+	if (start >= 0) {
+		of_lookup_stats.compatible_hits++;
+		seq = of_compat_index_find(compatible, start);
+
+		return seq < 0 ? NULL : of_compat_index.nodes[seq];
+	}
+
+	of_lookup_stats.compatible_walks++;
 
 	of_tree_for_each_node_from(np, from)
 		if (of_device_is_compatible(np, compatible))
@@ -742,13 +1011,37 @@ struct device_node *of_find_matching_node_and_match(struct device_node *from,
 					const struct of_device_id *matches,
 					const struct of_device_id **match)
 {
+	const struct of_device_id *m;
 	struct device_node *np;
+	int start, seq, best = -1;
 
 	if (match)
 		*match = NULL;
 
+	start = of_compat_index_start(from);
+	if (start >= 0 && matches) {
+		of_lookup_stats.compatible_hits++;
+
+		for (m = matches; m->compatible; m++) {
+			seq = of_compat_index_find(m->compatible, start);
+			if (seq >= 0 && (best < 0 || seq < best))
+				best = seq;
+		}
+
+		if (best < 0)
+			return NULL;
+
+		np = of_compat_index.nodes[best];
+		if (match)
+			*match = of_match_node(matches, np);
+
+		return np;
+	}
+
+	of_lookup_stats.compatible_walks++;
+
 	of_tree_for_each_node_from(np, from) {
-		const struct of_device_id *m = of_match_node(matches, np);
+		m = of_match_node(matches, np);
 		if (m) {
 			if (match)
 				*match = m;
@@ -1911,6 +2204,8 @@ int of_set_root_node(struct device_node *node)
 
 	root_node = node;
 
+	of_compat_index_invalidate();
+
 	of_chosen = of_find_node_by_path("/chosen");
 	of_property_read_string(root_node, "model", &of_model);
 
@@ -2404,11 +2699,8 @@ int of_diff(struct device_node *a, struct device_node *b, int indent)
 	return diff;
 }
 
-struct device_node *of_new_node(struct device_node *parent, const char *name)
+static void of_link_node(struct device_node *node, struct device_node *parent)
 {
-	struct device_node *node;
-
-	node = xzalloc(sizeof(*node));
 	node->parent = parent;
 	if (parent)
 		list_add_tail(&node->parent_list, &parent->children);
@@ -2416,17 +2708,39 @@ struct device_node *of_new_node(struct device_node *parent, const char *name)
 	INIT_LIST_HEAD(&node->children);
 	INIT_LIST_HEAD(&node->properties);
 
+	if (parent)
+		list_add(&node->list, &parent->list);
+	else
+		INIT_LIST_HEAD(&node->list);
+}
+
+static void of_link_property(struct device_node *node, struct property *prop)
+{
+	list_add_tail(&prop->list, &node->properties);
+
+	if (of_prop_is_compatible(prop->name))
+		of_compat_index_changed(node);
+}
+
+struct device_node *of_new_node(struct device_node *parent, const char *name)
+{
+	struct device_node *node;
+
+	node = xzalloc(sizeof(*node));
+
 	if (parent) {
 		node->name = xstrdup(name);
-		node->full_name = basprintf("%pOF/%s",
-					      node->parent, name);
-		list_add(&node->list, &parent->list);
+		node->full_name = basprintf("%pOF/%s", parent, name);
 	} else {
 		node->name = xstrdup("");
 		node->full_name = xstrdup("");
-		INIT_LIST_HEAD(&node->list);
 	}
 
+	of_link_node(node, parent);
+
+	if (parent)
+		of_compat_index_changed(parent);
+
 	return node;
 }
 
@@ -2440,7 +2754,7 @@ struct property *__of_new_property(struct device_node *node, const char *name,
 	prop->length = len;
 	prop->value = data;
 
-	list_add_tail(&prop->list, &node->properties);
+	of_link_property(node, prop);
 
 	return prop;
 }
@@ -2493,21 +2807,195 @@ struct property *of_new_property_const(struct device_node *node, const char *nam
 	prop->length = len;
 	prop->value_const = data;
 
-	list_add_tail(&prop->list, &node->properties);
+	of_link_property(node, prop);
 
 	return prop;
 }
 
+/*
+ * Trees unflattened from a dtb are allocated from an arena owned by the
+ * root node instead of with one malloc() per node, property and name.
+ * Nodes and properties added later come from the heap as usual, so
+ * everything that may be freed individually goes through of_free(),
+ * which leaves arena memory alone. The arena itself is released when
+ * its root node is deleted.
+ */
+struct of_arena {
+	struct list_head list;
+	struct device_node *root;
+	struct arena arena;
+};
+
+static LIST_HEAD(of_arenas);
+
+static bool of_arena_owns(const void *ptr)
+{
+	struct of_arena *oa;
+
+	list_for_each_entry(oa, &of_arenas, list)
+		if (arena_contains(&oa->arena, ptr))
+			return true;
+
+	return false;
+}
+
+/**
+ * of_free - free memory of a device tree node or property
+ * @ptr: a node, property, name or value to free
+ *
+ * Use this instead of free() for memory that may belong to an
+ * unflattened tree.
+ */
+void of_free(const void *ptr)
+{
+	if (!ptr || of_arena_owns(ptr))
+		return;
+
+	free((void *)ptr);
+}
+
+/**
+ * of_arena_new_root - create a root node owning a new arena
+ * @size: expected size of the tree in bytes
+ * @arena: returns the arena to allocate the rest of the tree from
+ *
+ * The arena is released when the root node is deleted.
+ *
+ * Return: the new root node or NULL when out of memory
+ */
+struct device_node *of_arena_new_root(size_t size, struct arena **arena)
+{
+	struct of_arena *oa = xzalloc(sizeof(*oa));
+	struct device_node *root;
+
+	arena_init(&oa->arena, size);
+
+	root = arena_zalloc(&oa->arena, sizeof(*root));
+	if (root)
+		root->name = root->full_name = arena_strdup(&oa->arena, "");
+
+	if (!root || !root->name) {
+		arena_free(&oa->arena);
+		free(oa);
+		return NULL;
+	}
+
+	of_link_node(root, NULL);
+
+	oa->root = root;
+	list_add(&oa->list, &of_arenas);
+	*arena = &oa->arena;
+
+	return root;
+}
+
+static void of_arena_release(struct device_node *root)
+{
+	struct of_arena *oa;
+
+	list_for_each_entry(oa, &of_arenas, list) {
+		if (oa->root != root)
+			continue;
+
+		list_del(&oa->list);
+		arena_free(&oa->arena);
+		free(oa);
+		return;
+	}
+}
+
+/**
+ * of_arena_new_node - allocate a node from an arena
+ * @arena: arena from of_arena_new_root()
+ * @parent: the parent node
+ * @name: the node name
+ *
+ * Return: the new node or NULL when out of memory
+ */
+struct device_node *of_arena_new_node(struct arena *arena,
+				      struct device_node *parent,
+				      const char *name)
+{
+	struct device_node *node;
+	size_t len;
+
+	node = arena_zalloc(arena, sizeof(*node));
+	if (!node)
+		return NULL;
+
+	node->name = arena_strdup(arena, name);
+	len = strlen(parent->full_name) + 1 + strlen(name) + 1;
+	node->full_name = arena_alloc(arena, len);
+	if (!node->name || !node->full_name)
+		return NULL;
+
+	sprintf(node->full_name, "%s/%s", parent->full_name, name);
+
+	of_link_node(node, parent);
+
+	return node;
+}
+
+/**
+ * of_arena_new_property - allocate a property from an arena
+ * @arena: arena from of_arena_new_root()
+ * @node: node to add the property to
+ * @name: property name, must live at least as long as @arena
+ * @data: the property value
+ * @len: length of @data
+ * @constprop: use @data directly instead of copying it into @arena
+ *
+ * Return: the new property or NULL when out of memory
+ */
+struct property *of_arena_new_property(struct arena *arena,
+				       struct device_node *node,
+				       const char *name, const void *data,
+				       int len, bool constprop)
+{
+	struct property *prop;
+
+	prop = arena_zalloc(arena, sizeof(*prop));
+	if (!prop)
+		return NULL;
+
+	prop->name = (char *)name;
+	prop->length = len;
+
+	if (constprop) {
+		prop->value_const = data;
+	} else {
+		/* at least one byte, so that empty properties are non-NULL */
+		prop->value = arena_alloc(arena, max(len, 1));
+		if (!prop->value)
+			return NULL;
+
+		memcpy(prop->value, data, len);
+	}
+
+	of_link_property(node, prop);
+
+	return prop;
+}
+
+static void __of_delete_property(struct property *pp)
+{
+	list_del(&pp->list);
+
+	of_free(pp->name);
+	of_free(pp->value);
+	of_free(pp);
+}
+
 void of_delete_property(struct property *pp)
 {
 	if (!pp)
 		return;
 
-	list_del(&pp->list);
+	/* we don't know the node here, so assume it's in the live tree */
+	if (of_prop_is_compatible(pp->name))
+		of_compat_index_changed(NULL);
 
-	free(pp->name);
-	free(pp->value);
-	free(pp);
+	__of_delete_property(pp);
 }
 
 struct property *of_rename_property(struct device_node *np,
@@ -2521,7 +3009,10 @@ struct property *of_rename_property(struct device_node *np,
 
 	of_property_write_bool(np, new_name, false);
 
-	free(pp->name);
+	if (of_prop_is_compatible(old_name) || of_prop_is_compatible(new_name))
+		of_compat_index_changed(np);
+
+	of_free(pp->name);
 	pp->name = xstrdup(new_name);
 	return pp;
 }
@@ -2588,6 +3079,12 @@ int of_append_property(struct device_node *np, const char *name, const void *val
 		return 0;
 	}
 
+	/* arena memory can't be reallocated, copy it like a const value */
+	if (pp->value && of_arena_owns(pp->value)) {
+		pp->value_const = pp->value;
+		pp->value = NULL;
+	}
+
 	orig_len = pp->length;
 	buf = realloc(pp->value, orig_len + len);
 	if (!buf)
@@ -2598,6 +3095,9 @@ int of_append_property(struct device_node *np, const char *name, const void *val
 	pp->value = buf;
 	pp->length += len;
 
+	if (of_prop_is_compatible(name))
+		of_compat_index_changed(np);
+
 	if (pp->value_const) {
 		memcpy(buf, pp->value_const, orig_len);
 		pp->value_const = NULL;
@@ -2628,11 +3128,14 @@ int of_prepend_property(struct device_node *np, const char *name, const void *va
 	memcpy(buf, val, len);
 	memcpy(buf + len, oldval, oldlen);
 
-	free(pp->value);
+	of_free(pp->value);
 	pp->value = buf;
 	pp->length = len + oldlen;
 	pp->value_const = NULL;
 
+	if (of_prop_is_compatible(name))
+		of_compat_index_changed(np);
+
 	return 0;
 }
 
@@ -2879,10 +3382,37 @@ struct device_node *of_dup(const struct device_node *root)
 	return of_copy_node(NULL, root);
 }
 
-void of_delete_node(struct device_node *node)
+static void __of_delete_node(struct device_node *node, bool flushed)
 {
 	struct device_node *n, *nt;
 	struct property *p, *pt;
+	bool is_root = !node->parent;
+
+	list_for_each_entry_safe(p, pt, &node->properties, list)
+		__of_delete_property(p);
+
+	list_for_each_entry_safe(n, nt, &node->children, parent_list)
+		__of_delete_node(n, flushed);
+
+	if (node->parent) {
+		list_del(&node->parent_list);
+		list_del(&node->list);
+	}
+
+	if (IS_ENABLED(CONFIG_OF_LOOKUP_INDEX) && !flushed)
+		of_phandle_cache_remove(node);
+
+	of_free(node->name);
+	of_free(node->full_name);
+	of_free(node);
+
+	if (is_root && !list_empty(&of_arenas))
+		of_arena_release(node);
+}
+
+void of_delete_node(struct device_node *node)
+{
+	bool flush;
 
 	if (!node)
 		return;
@@ -2892,20 +3422,14 @@ void of_delete_node(struct device_node *node)
 		return;
 	}
 
-	list_for_each_entry_safe(p, pt, &node->properties, list)
-		of_delete_property(p);
-
-	list_for_each_entry_safe(n, nt, &node->children, parent_list)
-		of_delete_node(n);
+	of_compat_index_changed(node);
 
-	if (node->parent) {
-		list_del(&node->parent_list);
-		list_del(&node->list);
-	}
+	/* Deleting a whole tree, drop all cached phandles at once */
+	flush = !node->parent;
+	if (flush)
+		memset(of_phandle_cache, 0, sizeof(of_phandle_cache));
 
-	free(node->name);
-	free(node->full_name);
-	free(node);
+	__of_delete_node(node, flush);
 }
 
 /*
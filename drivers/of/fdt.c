@@ -19,6 +19,8 @@
 #include <linux/string_helpers.h>
 #include <linux/err.h>
 
+#include "of_private.h"
+
 static inline bool __dt_ptr_ok(const struct fdt_header *fdt, const void *p,
 				  unsigned elem_size, unsigned elem_align)
 {
@@ -154,12 +156,91 @@ static int fdt_parse_header(const struct fdt_header *fdt, size_t fdt_size,
 	return 0;
 }
 
+#define OF_UNFLATTEN_MAX_DEPTH	32
+#define arena_sizeof(size)	ALIGN(size, sizeof(u64))
+
+/*
+ * Size the unflattened tree will take in its arena. This only walks the
+ * structure block, it stops silently at anything malformed and leaves
+ * reporting that to the actual unflatten pass.
+ */
+static size_t of_unflatten_size(const void *infdt, const struct fdt_header *f,
+				bool constprops)
+{
+	unsigned int pathlen[OF_UNFLATTEN_MAX_DEPTH];
+	const struct fdt_property *fdt_prop;
+	const struct fdt_node_header *fnh;
+	uint32_t dt_struct = f->off_dt_struct;
+	unsigned int depth = 0, plen = 0, parent;
+	size_t size, len, maxlen;
+
+	size = arena_sizeof(f->size_dt_strings);
+
+	while (dt_struct) {
+		const __be32 *tagp = infdt + dt_struct;
+
+		if (!dt_ptr_ok(infdt, tagp))
+			break;
+
+		switch (be32_to_cpu(*tagp)) {
+		case FDT_BEGIN_NODE:
+			fnh = infdt + dt_struct;
+			maxlen = f->off_dt_struct + f->size_dt_struct -
+				 (dt_struct + sizeof(*fnh));
+			len = strnlen(fnh->name, maxlen);
+
+			if (depth) {
+				parent = min_t(unsigned int, depth,
+					       OF_UNFLATTEN_MAX_DEPTH) - 1;
+				plen = pathlen[parent] + 1 + len;
+			}
+
+			if (depth < OF_UNFLATTEN_MAX_DEPTH)
+				pathlen[depth] = plen;
+			depth++;
+
+			size += arena_sizeof(sizeof(struct device_node)) +
+				arena_sizeof(len + 1) + arena_sizeof(plen + 1);
+
+			dt_struct = dt_struct_advance((struct fdt_header *)f, dt_struct,
+						      sizeof(*fnh) + len + 1);
+			break;
+		case FDT_END_NODE:
+			if (depth)
+				depth--;
+			dt_struct = dt_struct_advance((struct fdt_header *)f, dt_struct,
+						      FDT_TAGSIZE);
+			break;
+		case FDT_PROP:
+			fdt_prop = infdt + dt_struct;
+			len = fdt32_to_cpu(fdt_prop->len);
+
+			size += arena_sizeof(sizeof(struct property));
+			if (!constprops)
+				size += arena_sizeof(max_t(size_t, len, 1));
+
+			dt_struct = dt_struct_advance((struct fdt_header *)f, dt_struct,
+						      sizeof(*fdt_prop) + len);
+			break;
+		case FDT_NOP:
+			dt_struct = dt_struct_advance((struct fdt_header *)f, dt_struct,
+						      FDT_TAGSIZE);
+			break;
+		default:
+			return size;
+		}
+	}
+
+	return size;
+}
+
 /**
  * of_unflatten_dtb - unflatten a dtb binary blob
  * @infdt - the fdt blob to unflatten
  *
  * Parse a flat device tree binary blob and return a pointer to the
- * unflattened tree.
+ * unflattened tree. The whole tree is allocated from one arena sized in
+ * advance, property names point into a copy of the strings block.
  */
 static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 					      bool constprops)
@@ -174,7 +255,9 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 	uint32_t dt_struct;
 	const struct fdt_node_header *fnh;
 	void *dt_strings;
+	char *strings;
 	struct fdt_header f;
+	struct arena *arena;
 	int ret;
 	unsigned int maxlen;
 	const struct fdt_header *fdt = infdt;
@@ -186,10 +269,16 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 	dt_struct = f.off_dt_struct;
 	dt_strings = (void *)fdt + f.off_dt_strings;
 
-	root = of_new_node(NULL, NULL);
+	root = of_arena_new_root(of_unflatten_size(infdt, &f, constprops), &arena);
 	if (!root)
 		return ERR_PTR(-ENOMEM);
 
+	strings = arena_memdup(arena, dt_strings, f.size_dt_strings);
+	if (!strings) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
 	ret = of_unflatten_reservemap(root, fdt);
 	if (ret)
 		goto err;
@@ -229,7 +318,11 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 					ret = -EINVAL;
 					goto err;
 				}
-				node = of_new_node(node, pathp);
+				node = of_arena_new_node(arena, node, pathp);
+				if (!node) {
+					ret = -ENOMEM;
+					goto err;
+				}
 			}
 
 			dt_struct = dt_struct_advance(&f, dt_struct,
@@ -261,10 +354,13 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 				goto err;
 			}
 
-			if (constprops)
-				p = of_new_property_const(node, name, nodep, len);
-			else
-				p = of_new_property(node, name, nodep, len);
+			p = of_arena_new_property(arena, node,
+						  strings + (name - (char *)dt_strings),
+						  nodep, len, constprops);
+			if (!p) {
+				ret = -ENOMEM;
+				goto err;
+			}
 
 			if (!strcmp(name, "phandle") && len == 4)
 				node->phandle = be32_to_cpup(of_property_get_value(p));
@@ -330,10 +426,8 @@ struct device_node *of_unflatten_dtb_const(const void *infdt, int size)
 struct fdt {
 	void *dt;
 	uint32_t dt_nextofs;
-	uint32_t dt_size;
 	char *strings;
 	uint32_t str_nextofs;
-	uint32_t str_size;
 };
 
 static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
@@ -341,139 +435,69 @@ static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
 	return ALIGN(curofs + len, 4);
 }
 
-static int lstrcpy(char *dest, const char *src)
-{
-	int len = 0;
-	int maxlen = 1023;
-
-	do {
-		*dest++ = *src;
-		len++;
-		if (!maxlen)
-			return -ENOSPC;
-		maxlen--;
-	} while (*src++);
-
-	return len - 1;
-}
-
-static void *memalign_realloc(void *orig, size_t oldsize, size_t newsize)
-{
-	int align;
-	void *newbuf;
-
-	/*
-	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
-	 * for mapping the devicetree, so we are not allowed to cross
-	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
-	 */
-	align = 1 << fls(newsize - 1);
-
-	if (!orig)
-		return memalign(align, newsize);
-
-	newbuf = memalign(align, newsize);
-	if (!newbuf) {
-		free(orig);
-		return NULL;
-	}
-
-	memcpy(newbuf, orig, oldsize);
-	free(orig);
-	memset(newbuf + oldsize, 0, newsize - oldsize);
-
-	return newbuf;
-}
-
-static int fdt_ensure_space(struct fdt *fdt, int dtsize)
+/*
+ * Compute the size of the structure and strings blocks up front, so that
+ * the dtb can be written into a single allocation of the final size.
+ */
+static void of_flatten_size(const struct device_node *node, int is_root,
+			    size_t *dt_size, size_t *str_size)
 {
-	size_t new_size;
-	void *previous;
+	const struct property *p;
+	const struct device_node *n;
 
-	/*
-	 * We assume strings and names have a maximum length of 1024
-	 * whereas properties can be longer. We allocate new memory
-	 * if we have less than 1024 bytes (+ the property size left.
-	 */
-	if (fdt->str_size - fdt->str_nextofs < 1024) {
-		previous = fdt->strings;
-		new_size = fdt->str_size * 2;
-
-		fdt->strings = realloc(previous, new_size);
-		if (!fdt->strings) {
-			free(previous);
-			return -ENOMEM;
-		}
+	*dt_size = dt_next_ofs(*dt_size, sizeof(struct fdt_node_header) +
+			       strlen(node->name) + 1);
 
-		fdt->str_size = new_size;
+	list_for_each_entry(p, &node->properties, list) {
+		*dt_size = dt_next_ofs(*dt_size, sizeof(struct fdt_property) +
+				       p->length);
+		*str_size += strlen(p->name) + 1;
 	}
 
-	if (fdt->dt_size - fdt->dt_nextofs < 1024 + dtsize) {
-		previous = fdt->dt;
-		new_size = fdt->dt_size * 2;
-
-		if (new_size <= dtsize)
-			new_size = roundup_pow_of_two(fdt->dt_size + dtsize);
-
-		fdt->dt = memalign_realloc(previous, fdt->dt_size, new_size);
-		if (!fdt->dt) {
-			free(previous);
-			return -ENOMEM;
-		}
+	list_for_each_entry(n, &node->children, parent_list) {
+		if (is_root && !strcmp(n->name, "memreserve"))
+			continue;
 
-		fdt->dt_size = new_size;
+		of_flatten_size(n, 0, dt_size, str_size);
 	}
 
-	return 0;
+	*dt_size = dt_next_ofs(*dt_size, sizeof(struct fdt_node_header));
 }
 
-static inline int dt_add_string(struct fdt *fdt, const char *str)
+static uint32_t dt_add_string(struct fdt *fdt, const char *str)
 {
-	uint32_t ret;
-	int len;
-
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
-	len = lstrcpy(fdt->strings + fdt->str_nextofs, str);
-	if (len < 0)
-		return -ENOSPC;
+	uint32_t ofs = fdt->str_nextofs;
+	size_t len = strlen(str) + 1;
 
-	ret = fdt->str_nextofs;
+	memcpy(fdt->strings + ofs, str, len);
+	fdt->str_nextofs += len;
 
-	fdt->str_nextofs += len + 1;
-
-	return ret;
+	return ofs;
 }
 
-static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_root)
+static void __of_flatten_dtb(struct fdt *fdt, const struct device_node *node,
+			     int is_root)
 {
-	struct property *p;
-	struct device_node *n;
-	int ret;
-	unsigned int len;
+	const struct property *p;
+	const struct device_node *n;
 	struct fdt_node_header *nh;
-
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
+	size_t len;
 
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_BEGIN_NODE);
-	len = lstrcpy(nh->name, node->name);
+	len = strlen(node->name);
+	memcpy(nh->name, node->name, len + 1);
 	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs, 4 + len + 1);
 
 	list_for_each_entry(p, &node->properties, list) {
 		struct fdt_property *fp;
 
-		if (fdt_ensure_space(fdt, p->length) < 0)
-			return -ENOMEM;
-
 		fp = fdt->dt + fdt->dt_nextofs;
 
 		fp->tag = cpu_to_fdt32(FDT_PROP);
 		fp->len = cpu_to_fdt32(p->length);
 		fp->nameoff = cpu_to_fdt32(dt_add_string(fdt, p->name));
-		memcpy(fp->data, p->value, p->length);
+		memcpy(fp->data, of_property_get_value(p), p->length);
 		fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 				sizeof(struct fdt_property) + p->length);
 	}
@@ -482,20 +506,13 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
 		if (is_root && !strcmp(n->name, "memreserve"))
 			continue;
 
-		ret = __of_flatten_dtb(fdt, n, 0);
-		if (ret)
-			return ret;
+		__of_flatten_dtb(fdt, n, 0);
 	}
 
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_END_NODE);
 	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 			sizeof(struct fdt_node_header));
-
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
-	return 0;
 }
 
 /**
@@ -504,78 +521,78 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node, int is_ro
  */
 void *of_flatten_dtb(struct device_node *node)
 {
-	int ret;
 	struct fdt_header header = {};
 	struct fdt fdt = {};
 	uint32_t ofs, off_mem_rsvmap;
 	struct fdt_node_header *nh;
 	struct device_node *memreserve;
+	size_t dt_size, str_size = 0, totalsize;
 	int len;
 
 	header.magic = cpu_to_fdt32(FDT_MAGIC);
 	header.version = cpu_to_fdt32(0x11);
 	header.last_comp_version = cpu_to_fdt32(0x10);
 
-	fdt.dt = xmemalign(SZ_64K, SZ_64K);
-	fdt.dt_size = SZ_64K;
-
-	fdt.strings = xzalloc(SZ_64K);
-	fdt.str_size = SZ_64K;
-
-	memset(fdt.dt, 0, SZ_64K);
-
 	ofs = sizeof(struct fdt_header);
 
 	off_mem_rsvmap = ofs;
 	header.off_mem_rsvmap = cpu_to_fdt32(off_mem_rsvmap);
 	ofs += sizeof(struct fdt_reserve_entry) * OF_MAX_RESERVE_MAP;
 
+	dt_size = ofs;
+	of_flatten_size(node, 1, &dt_size, &str_size);
+	dt_size = dt_next_ofs(dt_size, sizeof(struct fdt_node_header));
+
+	totalsize = dt_size + str_size;
+	if (totalsize > INT_MAX)
+		return NULL;
+
+	/*
+	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
+	 * for mapping the devicetree, so we are not allowed to cross
+	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
+	 */
+	fdt.dt = memalign(max_t(size_t, SZ_64K, roundup_pow_of_two(totalsize)),
+			  totalsize);
+	if (!fdt.dt)
+		return NULL;
+
+	memset(fdt.dt, 0, totalsize);
+
 	fdt.dt_nextofs = ofs;
+	fdt.strings = fdt.dt + dt_size;
 
-	ret = __of_flatten_dtb(&fdt, node, 1);
-	if (ret)
-		goto out_free;
+	__of_flatten_dtb(&fdt, node, 1);
 
 	memreserve = of_find_node_by_name_address(node, "memreserve");
 	if (memreserve) {
 		const void *entries = of_get_property(memreserve, "reg", &len);
 
 		if (entries)
-			memcpy(fdt.dt + off_mem_rsvmap, entries, len);
+			memcpy(fdt.dt + off_mem_rsvmap, entries,
+			       min_t(size_t, len, ofs - off_mem_rsvmap));
 	}
 
 	nh = fdt.dt + fdt.dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_END);
 	fdt.dt_nextofs = dt_next_ofs(fdt.dt_nextofs, sizeof(struct fdt_node_header));
 
+	if (WARN_ON(fdt.dt_nextofs != dt_size || fdt.str_nextofs != str_size)) {
+		free(fdt.dt);
+		return NULL;
+	}
+
 	header.off_dt_struct = cpu_to_fdt32(ofs);
 	header.size_dt_struct = cpu_to_fdt32(fdt.dt_nextofs - ofs);
 
 	header.off_dt_strings = cpu_to_fdt32(fdt.dt_nextofs);
 	header.size_dt_strings = cpu_to_fdt32(fdt.str_nextofs);
 
-	if (fdt.dt_size - fdt.dt_nextofs < fdt.str_nextofs) {
-		fdt.dt = memalign_realloc(fdt.dt, fdt.dt_size,
-				fdt.dt_nextofs + fdt.str_nextofs);
-		if (!fdt.dt)
-			goto out_free;
-	}
-
-	memcpy(fdt.dt + fdt.dt_nextofs, fdt.strings, fdt.str_nextofs);
-
-	header.totalsize = cpu_to_fdt32(fdt.dt_nextofs + fdt.str_nextofs);
+	header.totalsize = cpu_to_fdt32(totalsize);
 
 	memcpy(fdt.dt, &header, sizeof(header));
 
-	free(fdt.strings);
-
 	return fdt.dt;
-
-out_free:
-	free(fdt.strings);
-	free(fdt.dt);
-
-	return NULL;
 }
 
 /*
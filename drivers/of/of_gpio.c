@@ -112,6 +112,7 @@ int of_get_named_gpio_flags(struct device_node *np, const char *propname,
 
 	chip = of_find_gpiochip_by_xlate(&gpiospec);
 	if (!chip) {
+		device_defer_on(gpiospec.np);
 		ret = -EPROBE_DEFER;
 		goto out;
 	}
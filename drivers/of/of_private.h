@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __OF_PRIVATE_H
+#define __OF_PRIVATE_H
+
+#include <of.h>
+#include <arena.h>
+
+struct device_node *of_arena_new_root(size_t size, struct arena **arena);
+struct device_node *of_arena_new_node(struct arena *arena,
+				      struct device_node *parent,
+				      const char *name);
+struct property *of_arena_new_property(struct arena *arena,
+				       struct device_node *node,
+				       const char *name, const void *data,
+				       int len, bool constprop);
+
+#endif /* __OF_PRIVATE_H */
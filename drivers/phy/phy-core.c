@@ -248,6 +248,8 @@ static struct phy_provider *of_phy_provider_lookup(struct device_node *node)
 				return phy_provider;
 	}
 
+	device_defer_on(node);
+
 	return ERR_PTR(-EPROBE_DEFER);
 }
 
@@ -400,6 +400,7 @@ static struct regulator_dev *of_regulator_get(struct device *dev,
 	 * added in future initcalls, so, instead of reporting a
 	 * complete failure report probe deferral
 	 */
+	device_defer_on(node);
 	rdev = ERR_PTR(-EPROBE_DEFER);
 out:
 	free(propname);
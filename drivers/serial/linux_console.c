@@ -21,6 +21,18 @@ static void linux_console_putc(struct console_device *cdev, char c)
 	linux_write(d->stdoutfd, &c, 1);
 }
 
+static int linux_console_write(struct console_device *cdev, const char *s,
+			       size_t nbytes)
+{
+	struct device *dev = cdev->dev;
+	struct linux_console_data *d = dev->platform_data;
+	ssize_t ret;
+
+	ret = linux_write(d->stdoutfd, s, nbytes);
+
+	return ret;
+}
+
 static int linux_console_tstc(struct console_device *cdev)
 {
 	struct device *dev = cdev->dev;
@@ -56,8 +68,10 @@ static int linux_console_probe(struct device *dev)
 		cdev->tstc = linux_console_tstc;
 		cdev->getc = linux_console_getc;
 	}
-	if (data->stdoutfd >= 0)
+	if (data->stdoutfd >= 0) {
 		cdev->putc = linux_console_putc;
+		cdev->write = linux_console_write;
+	}
 
 	console_register(cdev);
 
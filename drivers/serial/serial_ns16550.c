@@ -35,6 +35,8 @@ struct ns16550_priv {
 	struct NS16550_plat plat;
 	struct clk *clk;
 	uint32_t fcrval;
+	/* bytes the TX FIFO takes once LSR_THRE is set */
+	u32 fifosize;
 	void __iomem *mmiobase;
 	unsigned iobase;
 	void (*write_reg)(struct ns16550_priv *, uint8_t val, unsigned offset);
@@ -51,6 +53,8 @@ struct ns16550_drvdata {
         const char *linux_console_name;
         const char *linux_earlycon_name;
 	unsigned int clk_default;
+	/* TX FIFO size if known, unknown ones are written byte by byte */
+	unsigned int fifosize;
 };
 
 static inline struct ns16550_priv *to_ns16550_priv(struct console_device *cdev)
@@ -302,6 +306,37 @@ static void ns16550_putc(struct console_device *cdev, char c)
 	}
 }
 
+/**
+ * @brief Write as many characters as the TX FIFO takes without waiting
+ *
+ * @param[in] cdev pointer to console device
+ * @param[in] s characters to write
+ * @param[in] nbytes number of characters
+ *
+ * @return number of characters written
+ */
+static int ns16550_write_fifo(struct console_device *cdev, const char *s,
+			      size_t nbytes)
+{
+	struct ns16550_priv *priv = to_ns16550_priv(cdev);
+	unsigned int i, burst;
+
+	if (priv->rs485_mode) {
+		ns16550_putc(cdev, *s);
+		return 1;
+	}
+
+	if (!(ns16550_read(cdev, lsr) & LSR_THRE))
+		return 0;
+
+	burst = priv->fcrval & FCR_FIFO_EN ? priv->fifosize : 1;
+
+	for (i = 0; i < min_t(size_t, nbytes, burst); i++)
+		ns16550_write(cdev, s[i], thr);
+
+	return i;
+}
+
 /**
  * @brief Retrieve a character from serial port
  *
@@ -353,6 +388,7 @@ static void ns16550_probe_dt(struct device *dev, struct ns16550_priv *priv)
 		priv->mmiobase += offset;
 	of_property_read_u32(np, "reg-shift", &priv->plat.shift);
 	of_property_read_u32(np, "reg-io-width", &width);
+	of_property_read_u32(np, "fifo-size", &priv->fifosize);
 	priv->rs485_rts_active_low =
 		of_property_read_bool(np, "rs485-rts-active-low");
 	priv->rs485_mode =
@@ -400,6 +436,13 @@ static struct ns16550_drvdata ns16550_drvdata = {
 	.linux_earlycon_name = "uart8250",
 };
 
+static struct ns16550_drvdata ns16550a_drvdata = {
+	.init_port = ns16550_serial_init_port,
+	.linux_console_name = "ttyS",
+	.linux_earlycon_name = "uart8250",
+	.fifosize = 16,
+};
+
 static __maybe_unused struct ns16550_drvdata omap_drvdata = {
 	.init_port = ns16550_omap_init_port,
 	.linux_console_name = "ttyO",
@@ -516,11 +559,16 @@ static int ns16550_probe(struct device *dev)
 		goto err;
 	}
 
+	priv->fifosize = devtype->fifosize;
+
 	if (plat)
 		priv->plat = *plat;
 	else
 		ns16550_probe_dt(dev, priv);
 
+	if (!priv->fifosize)
+		priv->fifosize = 1;
+
 	if (devtype->clk_default && !priv->plat.clock)
 		priv->plat.clock = devtype->clk_default;
 
@@ -544,6 +592,7 @@ static int ns16550_probe(struct device *dev)
 	cdev->dev = dev;
 	cdev->tstc = ns16550_tstc;
 	cdev->putc = ns16550_putc;
+	cdev->write = ns16550_write_fifo;
 	cdev->getc = ns16550_getc;
 	cdev->setbrg = priv->plat.clock ? ns16550_setbaudrate : NULL;
 	cdev->flush = ns16550_flush;
@@ -581,6 +630,7 @@ static struct of_device_id ns16550_serial_dt_ids[] = {
 		.data = &ns16450_drvdata,
 	}, {
 		.compatible = "ns16550a",
+		.data = &ns16550a_drvdata,
 	}, {
 		.compatible = "snps,dw-apb-uart",
 	}, {
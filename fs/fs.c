@@ -35,6 +35,7 @@
 #include <libfile.h>
 #include <parseopt.h>
 #include <linux/namei.h>
+#include <boottrace.h>
 
 char *mkmodestr(unsigned long mode, char *str)
 {
@@ -3186,6 +3187,7 @@ int mount(const char *device, const char *fsname, const char *pathname,
 	struct fs_device *fsdev;
 	int ret;
 	struct path path = {};
+	u64 start = boottrace_start();
 
 	if (d_root) {
 		ret = filename_lookup(AT_FDCWD, getname(pathname), LOOKUP_FOLLOW, &path);
@@ -3276,6 +3278,8 @@ int mount(const char *device, const char *fsname, const char *pathname,
 
 	path_put(&path);
 
+	boottrace_record("mount", start, "%s %s", fsname, pathname);
+
 	return 0;
 
 err_no_driver:
@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <linux/types.h>
+
+struct arena_chunk;
+
+/*
+ * An arena hands out memory from a few big chunks. Allocations can't be
+ * freed individually, instead everything allocated from an arena is
+ * released at once with arena_free(). Useful for data structures with
+ * many small objects sharing the same lifetime, e.g. an unflattened
+ * device tree.
+ */
+struct arena {
+	struct arena_chunk *chunks;
+	char *ptr;
+	size_t avail;
+	size_t chunk_size;
+};
+
+void arena_init(struct arena *arena, size_t chunk_size);
+void *arena_alloc(struct arena *arena, size_t size);
+void *arena_zalloc(struct arena *arena, size_t size);
+void *arena_memdup(struct arena *arena, const void *src, size_t size);
+char *arena_strdup(struct arena *arena, const char *str);
+bool arena_contains(const struct arena *arena, const void *ptr);
+size_t arena_size(const struct arena *arena);
+void arena_free(struct arena *arena);
+
+#endif /* __ARENA_H */
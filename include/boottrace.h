@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __BOOTTRACE_H
+#define __BOOTTRACE_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <clock.h>
+
+/*
+ * Boot time tracing
+ *
+ * Record the duration of an operation:
+ *
+ *	u64 start = boottrace_start();
+ *	do_something();
+ *	boottrace_record("category", start, "%s", name);
+ *
+ * Recorded events are kept in a ring buffer and can be read in Chrome
+ * trace event format from /dev/boottrace.
+ */
+#ifdef CONFIG_BOOTTRACE
+static inline u64 boottrace_start(void)
+{
+	return get_time_ns();
+}
+
+void boottrace_record(const char *category, u64 start, const char *fmt, ...)
+	__printf(3, 4);
+#else
+static inline u64 boottrace_start(void)
+{
+	return 0;
+}
+
+static inline __printf(3, 4) void boottrace_record(const char *category,
+						   u64 start,
+						   const char *fmt, ...)
+{
+}
+#endif
+
+#endif /* __BOOTTRACE_H */
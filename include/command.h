@@ -21,7 +21,9 @@
 
 extern struct list_head command_list;
 
-#define for_each_command(cmd)	list_for_each_entry(cmd, &command_list, list)
+struct list_head *command_list_get(void);
+
+#define for_each_command(cmd)	list_for_each_entry(cmd, command_list_get(), list)
 
 struct string_list;
 
@@ -38,6 +40,7 @@ struct command {
 	const char	*opts;		/* command options */
 
 	struct list_head list;		/* List of commands		*/
+	struct hlist_node hash;		/* runtime registered commands and aliases */
 	uint32_t	group;
 #ifdef	CONFIG_LONGHELP
 	const char	*help;		/* Help  message	(long)	*/
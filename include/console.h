@@ -33,6 +33,13 @@ struct console_device {
 	int (*tstc)(struct console_device *cdev);
 	void (*putc)(struct console_device *cdev, char c);
 	int (*puts)(struct console_device *cdev, const char *s, size_t nbytes);
+	/*
+	 * Optional: hand up to @nbytes to the hardware without waiting and
+	 * return the number of bytes taken, 0 if the transmitter is busy or
+	 * a negative error code if the console failed. With
+	 * CONFIG_CONSOLE_TX_BUFFER this makes the console buffered.
+	 */
+	int (*write)(struct console_device *cdev, const char *s, size_t nbytes);
 	int  (*getc)(struct console_device *cdev);
 	int (*setbrg)(struct console_device *cdev, int baudrate);
 	void (*flush)(struct console_device *cdev);
@@ -60,6 +67,8 @@ struct console_device {
 	struct cdev devfs;
 	struct cdev_operations fops;
 
+	struct kfifo *tx_fifo;
+
 	struct serdev_device serdev;
 };
 
@@ -104,6 +104,15 @@ struct device {
 	 * if a driver probe is deferred, this stores the last error
 	 */
 	char *deferred_probe_reason;
+
+	/*
+	 * if a driver probe is deferred, the supplier it waits for (if known),
+	 * the number of devices bound at that time and how often the probe
+	 * has been deferred
+	 */
+	struct device_node *deferred_supplier;
+	unsigned int deferred_bind_count;
+	unsigned int deferred_count;
 };
 
 struct class {
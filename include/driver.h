@@ -51,6 +51,9 @@ struct driver {
 		const struct of_device_id *of_compatible;
 		const struct of_device_id *of_match_table;
 	};
+
+	/*! Registration order on the bus */
+	unsigned int bus_seq;
 };
 
 /*@}*/	/* do not delete, doxygen relevant */
@@ -76,6 +79,11 @@ int register_device(struct device *);
  */
 int device_probe(struct device *dev);
 
+/* Record the supplier the device currently being probed waits for */
+void device_defer_on(struct device_node *supplier);
+
+void device_print_deferred_stats(void);
+
 /**
  * device_remove - Remove a device from its bus and driver
  *
@@ -373,11 +381,19 @@ struct bus_type {
 	struct list_head list;
 	struct list_head device_list;
 	struct list_head driver_list;
+
+	/* compatible -> driver index, see bus_match_candidates() */
+	struct hlist_head *match_index;
+	unsigned int driver_seq;
 };
 
 int bus_register(struct bus_type *bus);
 int device_match(struct device *dev, struct driver *drv);
 
+void bus_match_index_add(struct driver *drv);
+void bus_match_index_del(struct driver *drv);
+int bus_match_candidates(struct device *dev, struct driver **drvs, int max);
+
 extern struct list_head bus_list;
 
 /* Iterate over all buses
@@ -15,6 +15,9 @@
  */
 struct variable_d {
 	struct list_head list;
+	struct hlist_node hash_node;
+	struct list_head *head;
+	u32 hash;
 	char *name;
 	char *data;
 };
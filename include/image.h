@@ -317,6 +317,7 @@ struct uimage_handle {
 	int nb_data_entries;
 	size_t data_offset;
 	int fd;
+	const void *map;
 };
 
 #define UIMAGE_INVALID_ADDRESS	(~0)
@@ -70,6 +70,35 @@ typedef void (*exitcall_t)(void);
 #define environment_initcall(fn)	__define_initcall(fn, 15)
 #define postenvironment_initcall(fn)	__define_initcall(fn, 16)
 
+int initcall_machine_match(const char *compat);
+
+/*
+ * Board specific initcalls in multi-board images: @fn is only called when
+ * the device tree root node is compatible to @compat. This is equivalent
+ * to an of_machine_is_compatible() check at the beginning of @fn, but
+ * makes the skipped calls visible in the initcall report.
+ */
+#define __define_machine_initcall(fn, id, compat)			\
+	static int __machine_##fn(void)					\
+	{								\
+		return initcall_machine_match(compat) ? fn() : 0;	\
+	}								\
+	__define_initcall(__machine_##fn, id)
+
+#define core_machine_initcall(fn, compat)	__define_machine_initcall(fn, 1, compat)
+#define postcore_machine_initcall(fn, compat)	__define_machine_initcall(fn, 2, compat)
+#define console_machine_initcall(fn, compat)	__define_machine_initcall(fn, 3, compat)
+#define postconsole_machine_initcall(fn, compat) __define_machine_initcall(fn, 4, compat)
+#define mem_machine_initcall(fn, compat)	__define_machine_initcall(fn, 5, compat)
+#define postmem_machine_initcall(fn, compat)	__define_machine_initcall(fn, 6, compat)
+#define mmu_machine_initcall(fn, compat)	__define_machine_initcall(fn, 7, compat)
+#define postmmu_machine_initcall(fn, compat)	__define_machine_initcall(fn, 8, compat)
+#define coredevice_machine_initcall(fn, compat)	__define_machine_initcall(fn, 9, compat)
+#define fs_machine_initcall(fn, compat)		__define_machine_initcall(fn, 10, compat)
+#define device_machine_initcall(fn, compat)	__define_machine_initcall(fn, 11, compat)
+#define late_machine_initcall(fn, compat)	__define_machine_initcall(fn, 14, compat)
+#define environment_machine_initcall(fn, compat) __define_machine_initcall(fn, 15, compat)
+
 #define early_exitcall(fn)		__define_exitcall(fn, 0)
 #define predevshutdown_exitcall(fn)	__define_exitcall(fn, 1)
 #define devshutdown_exitcall(fn)	__define_exitcall(fn, 2)
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __INITCALL_REPORT_H
+#define __INITCALL_REPORT_H
+
+#include <init.h>
+#include <clock.h>
+#include <linux/types.h>
+
+struct driver;
+
+/*
+ * Initcall and driver registration cost report
+ *
+ * Unlike the boot trace, this keeps one entry per initcall and per
+ * driver registration with the time spent in it. The initcalls command
+ * prints these entries.
+ */
+#ifdef CONFIG_INITCALL_REPORT
+static inline u64 initcall_report_start(void)
+{
+	return get_time_ns();
+}
+
+void initcall_report_record(initcall_t fn, u64 start);
+void initcall_report_skipped(void);
+void driver_report_record(struct driver *drv, u64 start, unsigned int tried);
+
+void initcall_report_print(unsigned int max, bool drivers);
+#else
+static inline u64 initcall_report_start(void)
+{
+	return 0;
+}
+
+static inline void initcall_report_record(initcall_t fn, u64 start)
+{
+}
+
+static inline void initcall_report_skipped(void)
+{
+}
+
+static inline void driver_report_record(struct driver *drv, u64 start,
+					unsigned int tried)
+{
+}
+#endif
+
+#endif /* __INITCALL_REPORT_H */
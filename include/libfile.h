@@ -22,6 +22,8 @@ void *read_fd(int fd, size_t *size);
 
 int read_file_2(const char *filename, size_t *size, void **outbuf,
 		loff_t max_size);
+int read_file_mapped(const char *filename, size_t *size, const void **outbuf,
+		     void **outalloc, loff_t max_size);
 
 int write_file(const char *filename, const void *buf, size_t size);
 int write_file_flash(const char *filename, const void *buf, size_t size);
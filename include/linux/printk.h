@@ -177,6 +177,7 @@ struct log_entry {
 	struct list_head list;
 	uint64_t timestamp;
 	int level;
+	bool deferred;
 	char msg[];
 };
 
@@ -184,6 +185,14 @@ extern struct list_head barebox_logbuf;
 
 extern void log_clean(unsigned int limit);
 
+#ifdef CONFIG_CONSOLE_DEFER_LOG
+void log_release_deferred(void);
+#else
+static inline void log_release_deferred(void)
+{
+}
+#endif
+
 #define BAREBOX_LOG_PRINT_RAW		BIT(2)
 #define BAREBOX_LOG_DIFF_TIME		BIT(1)
 #define BAREBOX_LOG_PRINT_TIME		BIT(0)
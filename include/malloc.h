@@ -17,4 +17,14 @@ void *sbrk(ptrdiff_t increment);
 
 int mem_malloc_is_initialized(void);
 
+#ifdef CONFIG_MALLOC_STATS
+/* malloc() accounted to @caller instead of its direct caller */
+void *__malloc_caller(size_t bytes, unsigned long caller) __alloc_size(1);
+#else
+static inline void *__malloc_caller(size_t bytes, unsigned long caller)
+{
+	return malloc(bytes);
+}
+#endif
+
 #endif /* __MALLOC_H */
@@ -18,5 +18,8 @@ struct mem_test_resource *mem_test_biggest_region(struct list_head *list);
 
 int mem_test_bus_integrity(resource_size_t _start, resource_size_t _end, unsigned flags);
 int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end, unsigned flags);
+int mem_test_patterns(resource_size_t _start, resource_size_t _end, unsigned flags);
+
+u64 mem_test_rate(u64 bytes, u64 ns);
 
 #endif /* __MEMTEST_H */
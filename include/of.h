@@ -161,6 +161,7 @@ extern struct property *of_new_property_const(struct device_node *node,
 extern struct property *__of_new_property(struct device_node *node,
 					  const char *name, void *data, int len);
 extern void of_delete_property(struct property *pp);
+extern void of_free(const void *ptr);
 extern struct property *of_rename_property(struct device_node *np,
 					   const char *old_name, const char *new_name);
 extern struct property *of_copy_property(const struct device_node *src,
@@ -316,6 +317,7 @@ extern int of_modalias_node(struct device_node *node, char *modalias, int len);
 
 extern struct device_node *of_get_root_node(void);
 extern int of_set_root_node(struct device_node *node);
+extern void of_lookup_stats_print(void);
 extern int barebox_register_of(struct device_node *root);
 extern int barebox_register_fdt(const void *dtb);
 
@@ -462,6 +464,10 @@ static inline int of_set_root_node(struct device_node *node)
 	return -ENOSYS;
 }
 
+static inline void of_lookup_stats_print(void)
+{
+}
+
 static inline int barebox_register_of(struct device_node *root)
 {
 	return -ENOSYS;
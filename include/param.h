@@ -37,6 +37,8 @@ struct param_d {
 	struct device *dev;
 	void *driver_priv;
 	struct list_head list;
+	struct hlist_node hash_node;
+	u32 hash;
 	enum param_type type;
 };
 
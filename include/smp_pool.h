@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __SMP_POOL_H
+#define __SMP_POOL_H
+
+#include <linux/types.h>
+#include <linux/string.h>
+
+/**
+ * typedef smp_pool_fn - work item callback
+ * @data: opaque pointer passed to smp_pool_run()
+ * @idx: index of the work item, 0 <= idx < n
+ * @cpu: logical pool CPU executing the item, 0 is the boot CPU
+ *
+ * Work items run concurrently on all pool CPUs. They must not call
+ * into anything that is not reentrant, which in barebox is almost
+ * everything: no malloc, no console output, no driver calls. Restrict
+ * them to operating on memory that was set up beforehand.
+ */
+typedef void (*smp_pool_fn)(void *data, unsigned int idx, unsigned int cpu);
+
+/**
+ * struct smp_pool_ops - architecture backend of the SMP worker pool
+ * @cpu_start: power up secondary @cpu and have it call
+ *             smp_pool_secondary_main(@cpu) on its own stack
+ * @cpu_exit: called on a secondary that leaves the pool. Must not return
+ * @cpu_wait_off: called on the boot CPU after @cpu has left the pool.
+ *                Returns once the CPU is safely powered down or parked
+ * @wait: wait for an event, e.g. wfe, after checking a condition
+ * @kick: wake up CPUs blocked in @wait, e.g. sev
+ * @sync: optional, called on a secondary before it runs the items of a
+ *        new job to pick up mapping changes done by the boot CPU, e.g.
+ *        by invalidating its local TLB
+ */
+struct smp_pool_ops {
+	int (*cpu_start)(unsigned int cpu);
+	void (*cpu_exit)(unsigned int cpu) __noreturn;
+	int (*cpu_wait_off)(unsigned int cpu);
+	void (*wait)(void);
+	void (*kick)(void);
+	void (*sync)(void);
+};
+
+#ifdef CONFIG_SMP_POOL
+int smp_pool_register(const struct smp_pool_ops *ops, unsigned int ncpus);
+void smp_pool_secondary_main(unsigned int cpu) __noreturn;
+
+unsigned int smp_pool_cpus(void);
+bool smp_pool_online(void);
+void smp_pool_run(smp_pool_fn fn, void *data, unsigned int n);
+int smp_pool_park(void);
+
+void *smp_memset(void *s, int c, size_t n);
+void *smp_memcpy(void *dest, const void *src, size_t n);
+#else
+static inline unsigned int smp_pool_cpus(void)
+{
+	return 1;
+}
+
+static inline bool smp_pool_online(void)
+{
+	return false;
+}
+
+static inline void smp_pool_run(smp_pool_fn fn, void *data, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		fn(data, i, 0);
+}
+
+static inline int smp_pool_park(void)
+{
+	return 0;
+}
+
+static inline void *smp_memset(void *s, int c, size_t n)
+{
+	return memset(s, c, n);
+}
+
+static inline void *smp_memcpy(void *dest, const void *src, size_t n)
+{
+	return memcpy(dest, src, n);
+}
+#endif
+
+#endif /* __SMP_POOL_H */
@@ -4,6 +4,7 @@
 
 #include <linux/string.h>
 #include <linux/minmax.h>
+#include <linux/ctype.h>
 
 void *mempcpy(void *dest, const void *src, size_t count);
 int strtobool(const char *str, int *val);
@@ -45,4 +46,30 @@ static inline const char *nonempty(const char *s)
 	return isempty(s) ? NULL : s;
 }
 
+/* FNV-1a, for hashing names into lookup tables */
+static inline u32 strhash(const char *s)
+{
+	u32 hash = 2166136261U;
+
+	while (*s) {
+		hash ^= (u8)*s++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* Like strhash(), but case-insensitive to go along with strcasecmp() */
+static inline u32 strcasehash(const char *s)
+{
+	u32 hash = 2166136261U;
+
+	while (*s) {
+		hash ^= (u8)tolower(*s++);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
 #endif /* __STRING_H */
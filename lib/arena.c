@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * arena.c - allocate many objects, free them all at once
+ */
+
+#include <common.h>
+#include <arena.h>
+#include <malloc.h>
+#include <string.h>
+
+#define ARENA_ALIGN	sizeof(u64)
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	u64 data[];
+};
+
+/**
+ * arena_init - initialize an empty arena
+ * @arena: the arena
+ * @chunk_size: size of the chunks memory is allocated in. When the total
+ *              size is known in advance, pass it here to get away with a
+ *              single chunk
+ */
+void arena_init(struct arena *arena, size_t chunk_size)
+{
+	arena->chunks = NULL;
+	arena->ptr = NULL;
+	arena->avail = 0;
+	arena->chunk_size = ALIGN(max_t(size_t, chunk_size, ARENA_ALIGN),
+				  ARENA_ALIGN);
+}
+
+static struct arena_chunk *arena_add_chunk(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk;
+
+	chunk = malloc(sizeof(*chunk) + size);
+	if (!chunk)
+		return NULL;
+
+	chunk->size = size;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+
+	return chunk;
+}
+
+/**
+ * arena_alloc - allocate memory from an arena
+ * @arena: the arena
+ * @size: number of bytes
+ *
+ * Return: memory aligned to 8 bytes or NULL when out of memory
+ */
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk;
+	void *mem;
+
+	size = ALIGN(size, ARENA_ALIGN);
+
+	if (size <= arena->avail) {
+		mem = arena->ptr;
+		arena->ptr += size;
+		arena->avail -= size;
+		return mem;
+	}
+
+	/*
+	 * Big objects get a chunk of their own, so the rest of the
+	 * current chunk is not wasted.
+	 */
+	if (size > arena->chunk_size / 4) {
+		chunk = arena_add_chunk(arena, size);
+
+		return chunk ? chunk->data : NULL;
+	}
+
+	chunk = arena_add_chunk(arena, arena->chunk_size);
+	if (!chunk)
+		return NULL;
+
+	arena->ptr = (char *)chunk->data + size;
+	arena->avail = arena->chunk_size - size;
+
+	return chunk->data;
+}
+
+void *arena_zalloc(struct arena *arena, size_t size)
+{
+	void *mem = arena_alloc(arena, size);
+
+	if (mem)
+		memset(mem, 0, size);
+
+	return mem;
+}
+
+void *arena_memdup(struct arena *arena, const void *src, size_t size)
+{
+	void *mem = arena_alloc(arena, size);
+
+	if (mem)
+		memcpy(mem, src, size);
+
+	return mem;
+}
+
+char *arena_strdup(struct arena *arena, const char *str)
+{
+	return arena_memdup(arena, str, strlen(str) + 1);
+}
+
+/**
+ * arena_contains - check whether memory was allocated from an arena
+ * @arena: the arena
+ * @ptr: pointer to check
+ */
+bool arena_contains(const struct arena *arena, const void *ptr)
+{
+	const struct arena_chunk *chunk;
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+		const char *data = (const char *)chunk->data;
+
+		if ((const char *)ptr >= data && (const char *)ptr < data + chunk->size)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * arena_size - number of bytes an arena has allocated from the heap
+ * @arena: the arena
+ */
+size_t arena_size(const struct arena *arena)
+{
+	const struct arena_chunk *chunk;
+	size_t size = 0;
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next)
+		size += chunk->size;
+
+	return size;
+}
+
+/**
+ * arena_free - free all memory allocated from an arena
+ * @arena: the arena
+ *
+ * The arena is empty afterwards and can be used again.
+ */
+void arena_free(struct arena *arena)
+{
+	struct arena_chunk *chunk, *next;
+
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	arena->chunks = NULL;
+	arena->ptr = NULL;
+	arena->avail = 0;
+}
@@ -53,7 +53,16 @@
  *                 <= 22 + (uncompressed_size >> 15) + 131072
  */
 
-#ifndef STATIC
+#ifdef STATIC
+#include "xxhash.c"
+#include "zstd/entropy_common.c"
+#include "zstd/fse_decompress.c"
+/* redefined by zstd_internal.h */
+#undef CHECK_F
+#include "zstd/huf_decompress.c"
+#include "zstd/zstd_common.c"
+#include "zstd/decompress.c"
+#else
 #include <linux/decompress/unzstd.h>
 #endif
 
@@ -318,3 +327,12 @@ STATIC int INIT unzstd(unsigned char *buf, long len,
 {
 	return __unzstd(buf, len, fill, flush, out_buf, 0, pos, error);
 }
+
+#ifdef STATIC
+/*
+ * In the PBL the whole image is decompressed in one go, so only the
+ * fixed size ZSTD_DCtx workspace is allocated, no matter how large
+ * the window of the compressed data is.
+ */
+#define decompress unzstd
+#endif
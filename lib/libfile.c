@@ -92,6 +92,7 @@ int pread_full(int fd, void *buf, size_t size, loff_t offset)
 			return now;
 		size -= now;
 		buf += now;
+		offset += now;
 	}
 
 	return insize - size;
@@ -295,6 +296,72 @@ int read_file_2(const char *filename, size_t *size, void **outbuf,
 }
 EXPORT_SYMBOL(read_file_2);
 
+/**
+ * read_file_mapped - map a file or read it to an allocated buffer
+ * @filename:  The filename to read
+ * @size:      After successful return contains the size of the file
+ * @outbuf:    contains a pointer to the file data after successful return
+ * @outalloc:  contains the allocated buffer after successful return, or
+ *             NULL if the file has been mapped directly
+ * @max_size:  The maximum size to read. Use FILESIZE_MAX for reading files
+ *             of any size.
+ *
+ * Like read_file_2(), but if the file is backed by memory (e.g. a RAM
+ * device, a memory mapped flash or a ramfs file), return a pointer into
+ * the mapping instead of copying the data. The returned data must be
+ * treated as read-only. @outalloc must be passed to free() after usage.
+ *
+ * Return: 0 for success, or negative error code. -EFBIG is returned
+ * when the file has been bigger than max_size.
+ */
+int read_file_mapped(const char *filename, size_t *size, const void **outbuf,
+		     void **outalloc, loff_t max_size)
+{
+	struct stat s;
+	void *map;
+	int fd, ret;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return fd;
+
+	ret = fstat(fd, &s);
+	if (ret || s.st_size == FILESIZE_MAX) {
+		close(fd);
+		goto read;
+	}
+
+	map = memmap(fd, PROT_READ);
+	close(fd);
+
+	/* Don't hand out pointers into the faulting zero page */
+	if (map == MAP_FAILED || zero_page_contains((unsigned long)map))
+		goto read;
+
+	*outalloc = NULL;
+	*outbuf = map;
+
+	if (max_size != FILESIZE_MAX && max_size < s.st_size) {
+		if (size)
+			*size = max_size;
+		return -EFBIG;
+	}
+
+	if (size)
+		*size = s.st_size;
+
+	return 0;
+read:
+	ret = read_file_2(filename, size, outalloc, max_size);
+	if (ret && ret != -EFBIG)
+		return ret;
+
+	*outbuf = *outalloc;
+
+	return ret;
+}
+EXPORT_SYMBOL(read_file_mapped);
+
 /**
  * read_file - read a file to an allocated buffer
  * @filename:  The filename to read
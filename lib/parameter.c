@@ -29,6 +29,22 @@
 #include <linux/err.h>
 #include <file-list.h>
 #include <stringlist.h>
+#include <linux/hash.h>
+
+/*
+ * Parameters of all devices share one hash table, keyed by device and
+ * name, so global.* and nv.* lookups don't walk the parameter list of
+ * devices with hundreds of parameters. dev->parameters stays sorted by
+ * name for listing.
+ */
+#define PARAM_HASH_BITS	9
+
+static struct hlist_head param_hash[1 << PARAM_HASH_BITS];
+
+static struct hlist_head *param_hash_bucket(struct device *dev, u32 hash)
+{
+	return &param_hash[hash_32(hash ^ (u32)(ulong)dev, PARAM_HASH_BITS)];
+}
 
 static const char *param_type_string[] = {
 	[PARAM_TYPE_STRING] = "string",
@@ -51,10 +67,11 @@ const char *get_param_type(struct param_d *param)
 
 struct param_d *get_param_by_name(struct device *dev, const char *name)
 {
+	u32 hash = strhash(name);
 	struct param_d *p;
 
-	list_for_each_entry(p, &dev->parameters, list) {
-		if (!strcmp(p->name, name))
+	hlist_for_each_entry(p, param_hash_bucket(dev, hash), hash_node) {
+		if (p->dev == dev && p->hash == hash && !strcmp(p->name, name))
 			return p;
 	}
 
@@ -168,7 +185,9 @@ static int __dev_add_param(struct param_d *param, struct device *dev,
 
 	param->flags = flags;
 	param->dev = dev;
+	param->hash = strhash(name);
 	list_add_sort(&param->list, &dev->parameters, compare);
+	hlist_add_head(&param->hash_node, param_hash_bucket(dev, param->hash));
 
 	dev_param_init_from_nv(dev, name);
 
@@ -1013,6 +1032,7 @@ struct param_d *dev_add_param_file_list(struct device *dev, const char *name,
 void dev_remove_param(struct param_d *p)
 {
 	p->set(p->dev, p, NULL);
+	hlist_del(&p->hash_node);
 	list_del(&p->list);
 	free(p->name);
 	free(p);
@@ -1027,12 +1047,8 @@ void dev_remove_parameters(struct device *dev)
 {
 	struct param_d *p, *n;
 
-	list_for_each_entry_safe(p, n, &dev->parameters, list) {
-		p->set(dev, p, NULL);
-		list_del(&p->list);
-		free(p->name);
-		free(p);
-	}
+	list_for_each_entry_safe(p, n, &dev->parameters, list)
+		dev_remove_param(p);
 }
 
 /** @page dev_params Device parameters
@@ -25,6 +25,20 @@
 #include <asm/word-at-a-time.h>
 #include <malloc.h>
 
+/*
+ * The generic memory and string functions below work a word at a time
+ * where they can. They only ever access naturally aligned words, so
+ * where two buffers are involved, those need to share their misalignment
+ * for the word loops to be used.
+ */
+#define WORD_SIZE	sizeof(unsigned long)
+#define WORD_MASK	(WORD_SIZE - 1)
+
+static inline bool words_aligned(const void *a, const void *b)
+{
+	return !(((unsigned long)a ^ (unsigned long)b) & WORD_MASK);
+}
+
 #ifndef __HAVE_ARCH_STRCASECMP
 int strcasecmp(const char *s1, const char *s2)
 {
@@ -375,9 +389,30 @@ EXPORT_SYMBOL(_strrchr);
  */
 size_t strlen(const char * s)
 {
-	const char *sc;
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
+	const char *sc = s;
+	unsigned long c, data;
+
+	/*
+	 * Reading whole aligned words never crosses a page boundary, but
+	 * reads past the terminating zero, which userspace ASAN doesn't like.
+	 */
+	if (!IS_ENABLED(CONFIG_ASAN)) {
+		for (; (unsigned long)sc & WORD_MASK; sc++)
+			if (*sc == '\0')
+				return sc - s;
+
+		for (;; sc += WORD_SIZE) {
+			c = read_word_at_a_time(sc);
+			if (has_zero(c, &data, &constants)) {
+				data = prep_zero_mask(c, data, &constants);
+				data = create_zero_mask(data);
+				return sc - s + find_zero(data);
+			}
+		}
+	}
 
-	for (sc = s; *sc != '\0'; ++sc)
+	for (; *sc != '\0'; ++sc)
 		/* nothing */;
 	return sc - s;
 }
@@ -596,7 +631,29 @@ char *strswab(const char *s)
  */
 void *__default_memset(void * s, int c, size_t count)
 {
-	char *xs = (char *) s;
+	unsigned char *xs = s;
+	unsigned long pattern, *w;
+
+	if (count >= 2 * WORD_SIZE) {
+		for (; (unsigned long)xs & WORD_MASK; count--)
+			*xs++ = c;
+
+		pattern = REPEAT_BYTE((unsigned char)c);
+
+		for (; count >= 4 * WORD_SIZE; count -= 4 * WORD_SIZE) {
+			w = (unsigned long *)xs;
+			w[0] = pattern;
+			w[1] = pattern;
+			w[2] = pattern;
+			w[3] = pattern;
+			xs += 4 * WORD_SIZE;
+		}
+
+		for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+			*(unsigned long *)xs = pattern;
+			xs += WORD_SIZE;
+		}
+	}
 
 	while (count--)
 		*xs++ = c;
@@ -630,9 +687,46 @@ void *__memset(void *s, int c, size_t count) __alias(__default_memset);
  * You should not use this function to access IO space, use memcpy_toio()
  * or memcpy_fromio() instead.
  */
+static inline void copy_words_fwd(unsigned char **dest,
+				  const unsigned char **src, size_t *count)
+{
+	unsigned long *d = (unsigned long *)*dest;
+	const unsigned long *s = (const unsigned long *)*src;
+	unsigned long a, b, c, e;
+	size_t n = *count;
+
+	for (; n >= 4 * WORD_SIZE; n -= 4 * WORD_SIZE) {
+		a = s[0];
+		b = s[1];
+		c = s[2];
+		e = s[3];
+		d[0] = a;
+		d[1] = b;
+		d[2] = c;
+		d[3] = e;
+		d += 4;
+		s += 4;
+	}
+
+	for (; n >= WORD_SIZE; n -= WORD_SIZE)
+		*d++ = *s++;
+
+	*dest = (unsigned char *)d;
+	*src = (const unsigned char *)s;
+	*count = n;
+}
+
 void *__default_memcpy(void * dest,const void *src, size_t count)
 {
-	char *tmp = (char *) dest, *s = (char *) src;
+	unsigned char *tmp = dest;
+	const unsigned char *s = src;
+
+	if (count >= 2 * WORD_SIZE && words_aligned(tmp, s)) {
+		for (; (unsigned long)tmp & WORD_MASK; count--)
+			*tmp++ = *s++;
+
+		copy_words_fwd(&tmp, &s, &count);
+	}
 
 	while (count--)
 		*tmp++ = *s++;
@@ -676,20 +770,42 @@ EXPORT_SYMBOL(mempcpy);
  */
 void *__default_memmove(void * dest,const void *src,size_t count)
 {
-	char *tmp, *s;
+	unsigned char *tmp;
+	const unsigned char *s;
+	bool words = count >= 2 * WORD_SIZE && words_aligned(dest, src);
 
 	if (dest <= src) {
-		tmp = (char *) dest;
-		s = (char *) src;
+		tmp = dest;
+		s = src;
+
+		if (words) {
+			for (; (unsigned long)tmp & WORD_MASK; count--)
+				*tmp++ = *s++;
+
+			/* each word is read before the one below it is written */
+			copy_words_fwd(&tmp, &s, &count);
+		}
+
 		while (count--)
 			*tmp++ = *s++;
+	} else {
+		tmp = dest + count;
+		s = src + count;
+
+		if (words) {
+			for (; (unsigned long)tmp & WORD_MASK; count--)
+				*--tmp = *--s;
+
+			for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+				tmp -= WORD_SIZE;
+				s -= WORD_SIZE;
+				*(unsigned long *)tmp = *(const unsigned long *)s;
+			}
 		}
-	else {
-		tmp = (char *) dest + count;
-		s = (char *) src + count;
+
 		while (count--)
 			*--tmp = *--s;
-		}
+	}
 
 	return dest;
 }
@@ -711,10 +827,24 @@ void *__memmove(void * dest, const void *src, size_t count)
  */
 int memcmp(const void * cs,const void * ct,size_t count)
 {
-	const unsigned char *su1, *su2;
+	const unsigned char *su1 = cs, *su2 = ct;
 	int res = 0;
 
-	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
+	if (count >= 2 * WORD_SIZE && words_aligned(su1, su2)) {
+		for (; (unsigned long)su1 & WORD_MASK; ++su1, ++su2, count--)
+			if ((res = *su1 - *su2) != 0)
+				return res;
+
+		/* the first differing word is compared bytewise below */
+		for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+			if (*(const unsigned long *)su1 != *(const unsigned long *)su2)
+				break;
+			su1 += WORD_SIZE;
+			su2 += WORD_SIZE;
+		}
+	}
+
+	for (; 0 < count; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
 	return res;
@@ -784,7 +914,23 @@ EXPORT_SYMBOL(_strstr);
  */
 void *memchr(const void *s, int c, size_t n)
 {
+	const struct word_at_a_time constants = WORD_AT_A_TIME_CONSTANTS;
 	const unsigned char *p = s;
+	unsigned long pattern, data;
+
+	if (n >= 2 * WORD_SIZE) {
+		for (; (unsigned long)p & WORD_MASK; p++, n--)
+			if ((unsigned char)c == *p)
+				return (void *)p;
+
+		/* a word with a match has a zero byte after the XOR */
+		pattern = REPEAT_BYTE((unsigned char)c);
+		for (; n >= WORD_SIZE; p += WORD_SIZE, n -= WORD_SIZE)
+			if (has_zero(*(const unsigned long *)p ^ pattern, &data,
+				     &constants))
+				break;
+	}
+
 	while (n-- != 0) {
 		if ((unsigned char)c == *p++) {
 			return (void *)(p-1);
@@ -21,11 +21,16 @@
 #include <linux/xz.h>
 #include <linux/decompress/unlz4.h>
 #include <linux/decompress/unzstd.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
+#include <asm/unaligned.h>
 #include <errno.h>
 #include <filetype.h>
 #include <malloc.h>
 #include <fs.h>
 #include <libfile.h>
+#include <boottrace.h>
+#include <smp_pool.h>
 
 static void *uncompress_buf;
 static unsigned long uncompress_size;
@@ -77,6 +82,7 @@ int uncompress(unsigned char *inbuf, long len,
             void(*error)(char *x));
 	int ret;
 	char *err;
+	u64 start;
 
 	if (inbuf) {
 		ft = file_detect_type(inbuf, len);
@@ -139,8 +145,12 @@ int uncompress(unsigned char *inbuf, long len,
 		goto err;
 	}
 
+	start = boottrace_start();
+
 	ret = compfn(inbuf, len, fill ? uncompress_fill : NULL,
 			flush, output, pos, error_fn);
+
+	boottrace_record("decompress", start, "%s", file_type_to_short_string(ft));
 err:
 	free(uncompress_buf);
 
@@ -190,13 +200,316 @@ int uncompress_buf_to_fd(const void *input, size_t input_len,
 			  NULL, NULL, error_fn);
 }
 
+/*
+ * Multi-frame images consist of independently decodable frames whose
+ * position in the output is known up front. They are decoded directly into
+ * one buffer, frame by frame, which allows spreading the frames over
+ * multiple CPUs.
+ */
+struct uncompress_frame {
+	const void *in;
+	size_t in_len;
+	void *out;
+	size_t out_len;
+	int (*decode)(struct uncompress_frame *frame, void *wksp);
+	int ret;
+};
+
+#define ZSTD_SEEKTABLE_MAGIC	0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC	0x8F92EAB1
+#define ZSTD_SEEKTABLE_FOOTER	9
+
+static int uncompress_frame_zstd(struct uncompress_frame *frame, void *wksp)
+{
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	dctx = ZSTD_initDCtx(wksp, ZSTD_DCtxWorkspaceBound());
+	ret = ZSTD_decompressDCtx(dctx, frame->out, frame->out_len,
+				  frame->in, frame->in_len);
+
+	if (ZSTD_isError(ret) || ret != frame->out_len)
+		return -EILSEQ;
+
+	return 0;
+}
+
+/*
+ * Parse the seek table of the zstd seekable format, a skippable frame at
+ * the end of the image listing the compressed and decompressed size of
+ * all frames.
+ *
+ * The frame parsers return the number of frames or -ENOENT if the image
+ * can't be decoded frame by frame, including when the frame index doesn't
+ * look sane. Such images are still decompressed as a stream.
+ */
+static int uncompress_zstd_frames(const u8 *in, size_t len,
+				  struct uncompress_frame **outframes,
+				  size_t *outsize)
+{
+	const u8 *footer = in + len - ZSTD_SEEKTABLE_FOOTER;
+	struct uncompress_frame *frames;
+	size_t entry_size, table_size, pos = 0, size = 0;
+	const u8 *entry;
+	u32 nframes;
+	int i;
+
+	if (len < ZSTD_SEEKTABLE_FOOTER + 8 ||
+	    get_unaligned_le32(footer + 5) != ZSTD_SEEKABLE_MAGIC)
+		return -ENOENT;
+
+	nframes = get_unaligned_le32(footer);
+	entry_size = footer[4] & 0x80 ? 12 : 8;
+
+	if (nframes == 0 || nframes > len / entry_size)
+		return -ENOENT;
+
+	table_size = nframes * entry_size + ZSTD_SEEKTABLE_FOOTER;
+	if (table_size + 8 > len)
+		return -ENOENT;
+
+	entry = in + len - table_size - 8;
+	if (get_unaligned_le32(entry) != ZSTD_SEEKTABLE_MAGIC ||
+	    get_unaligned_le32(entry + 4) != table_size)
+		return -ENOENT;
+
+	len -= table_size + 8;
+	entry += 8;
+
+	frames = xzalloc(nframes * sizeof(*frames));
+
+	for (i = 0; i < nframes; i++, entry += entry_size) {
+		struct uncompress_frame *frame = &frames[i];
+
+		frame->in = in + pos;
+		frame->in_len = get_unaligned_le32(entry);
+		frame->out = (void *)size;
+		frame->out_len = get_unaligned_le32(entry + 4);
+		frame->decode = uncompress_frame_zstd;
+
+		pos += frame->in_len;
+		size += frame->out_len;
+		if (pos > len)
+			goto err;
+	}
+
+	if (pos != len)
+		goto err;
+
+	*outframes = frames;
+	*outsize = size;
+
+	return nframes;
+err:
+	free(frames);
+	return -ENOENT;
+}
+
+#define LZ4_LEGACY_MAGIC	0x184C2102
+#define LZ4_LEGACY_CHUNK_SIZE	(8 << 20)
+
+static int uncompress_frame_lz4(struct uncompress_frame *frame, void *wksp)
+{
+	size_t out_len = frame->out_len;
+	int ret;
+
+	ret = lz4_decompress_unknownoutputsize(frame->in, frame->in_len,
+					       frame->out, &out_len);
+	if (ret < 0)
+		return -EILSEQ;
+
+	frame->out_len = out_len;
+
+	return 0;
+}
+
+/*
+ * The legacy lz4 format already consists of independent chunks. All but
+ * the last one decompress to exactly 8MiB, so no seek table is needed.
+ */
+static int uncompress_lz4_frames(const u8 *in, size_t len,
+				 struct uncompress_frame **outframes,
+				 size_t *outsize)
+{
+	struct uncompress_frame *frames = NULL;
+	size_t pos = 0;
+	int n = 0;
+
+	while (pos + 4 <= len) {
+		u32 chunk = get_unaligned_le32(in + pos);
+
+		pos += 4;
+
+		if (chunk == LZ4_LEGACY_MAGIC)
+			continue;
+
+		/* the size of the decompressed data appended by the build */
+		if (pos == len && n)
+			break;
+
+		if (!n && pos != 8) {
+			free(frames);
+			return -ENOENT;
+		}
+
+		if (chunk > len - pos) {
+			free(frames);
+			return -ENOENT;
+		}
+
+		frames = xrealloc(frames, (n + 1) * sizeof(*frames));
+		frames[n] = (struct uncompress_frame) {
+			.in = in + pos,
+			.in_len = chunk,
+			.out = (void *)((size_t)n * LZ4_LEGACY_CHUNK_SIZE),
+			.out_len = LZ4_LEGACY_CHUNK_SIZE,
+			.decode = uncompress_frame_lz4,
+		};
+		n++;
+
+		pos += chunk;
+	}
+
+	/* nothing to gain from a single chunk */
+	if (n < 2) {
+		free(frames);
+		return -ENOENT;
+	}
+
+	*outframes = frames;
+	*outsize = (size_t)n * LZ4_LEGACY_CHUNK_SIZE;
+
+	return n;
+}
+
+struct uncompress_frames_job {
+	struct uncompress_frame *frames;
+	void **wksp;
+};
+
+static void uncompress_frame_work(void *data, unsigned int idx, unsigned int cpu)
+{
+	struct uncompress_frames_job *job = data;
+	struct uncompress_frame *frame = &job->frames[idx];
+
+	frame->ret = frame->decode(frame, job->wksp ? job->wksp[cpu] : NULL);
+}
+
+/*
+ * Frames are spread over all CPUs of the worker pool. Decoders run on the
+ * secondaries too, so they must not allocate: every CPU gets its own
+ * workspace of @wksp_size bytes up front.
+ */
+static int uncompress_frames_run(struct uncompress_frame *frames, int n,
+				 size_t wksp_size)
+{
+	struct uncompress_frames_job job = { .frames = frames };
+	unsigned int i, ncpus = smp_pool_cpus();
+	int ret = 0;
+
+	if (wksp_size) {
+		job.wksp = xzalloc(ncpus * sizeof(*job.wksp));
+		for (i = 0; i < ncpus; i++) {
+			job.wksp[i] = malloc(wksp_size);
+			if (!job.wksp[i]) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+	}
+
+	smp_pool_run(uncompress_frame_work, &job, n);
+out:
+	if (job.wksp) {
+		for (i = 0; i < ncpus; i++)
+			free(job.wksp[i]);
+		free(job.wksp);
+	}
+
+	return ret;
+}
+
+static ssize_t uncompress_frames(const void *input, size_t input_len,
+				 void **buf, void(*error_fn)(char *x))
+{
+	struct uncompress_frame *frames;
+	size_t size, wksp_size = 0;
+	void *out;
+	int i, n, ret;
+
+	switch (file_detect_type(input, input_len)) {
+	case filetype_zstd_compressed:
+		if (!IS_ENABLED(CONFIG_ZSTD_DECOMPRESS))
+			return -ENOENT;
+		n = uncompress_zstd_frames(input, input_len, &frames, &size);
+		wksp_size = ZSTD_DCtxWorkspaceBound();
+		break;
+	case filetype_lz4_compressed:
+		if (!IS_ENABLED(CONFIG_LZ4_DECOMPRESS))
+			return -ENOENT;
+		n = uncompress_lz4_frames(input, input_len, &frames, &size);
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (n < 0) {
+		pr_debug("no usable frame index, decompressing as a stream\n");
+		return n;
+	}
+
+	out = malloc(size);
+	if (!out) {
+		free(frames);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++)
+		frames[i].out = out + (size_t)frames[i].out;
+
+	ret = uncompress_frames_run(frames, n, wksp_size);
+	if (ret) {
+		free(out);
+		free(frames);
+		return ret;
+	}
+
+	for (i = 0; i < n; i++) {
+		ret = frames[i].ret;
+		/* only the last lz4 chunk may be shorter */
+		if (!ret && i < n - 1 &&
+		    frames[i].out + frames[i].out_len != frames[i + 1].out)
+			ret = -EILSEQ;
+		if (ret) {
+			error_fn("corrupt frame in multi-frame image");
+			free(out);
+			free(frames);
+			return ret;
+		}
+	}
+
+	size = frames[n - 1].out + frames[n - 1].out_len - out;
+
+	pr_debug("decompressed %d frames, %zu bytes\n", n, size);
+
+	free(frames);
+	*buf = out;
+
+	return size;
+}
+
 ssize_t uncompress_buf_to_buf(const void *input, size_t input_len,
 			      void **buf, void(*error_fn)(char *x))
 {
 	size_t size;
+	ssize_t frames_ret;
 	int fd, ret;
 	void *p;
 
+	frames_ret = uncompress_frames(input, input_len, buf, error_fn);
+	if (frames_ret != -ENOENT)
+		return frames_ret;
+
 	fd = open("/tmp", O_TMPFILE | O_RDWR);
 	if (fd < 0)
 		return -ENODEV;
@@ -33,15 +33,20 @@ static void __noreturn enomem_panic(size_t size)
 	panic("out of memory");
 }
 
-void *xmalloc(size_t size)
+static void *__xmalloc(size_t size, unsigned long caller)
 {
 	void *p = NULL;
 
-	if (!(p = malloc(size)))
+	if (!(p = __malloc_caller(size, caller)))
 		enomem_panic(size);
 
 	return p;
 }
+
+void *xmalloc(size_t size)
+{
+	return __xmalloc(size, _RET_IP_);
+}
 EXPORT_SYMBOL(xmalloc);
 
 void *xrealloc(void *ptr, size_t size)
@@ -57,7 +62,7 @@ EXPORT_SYMBOL(xrealloc);
 
 void *xzalloc(size_t size)
 {
-	void *ptr = xmalloc(size);
+	void *ptr = __xmalloc(size, _RET_IP_);
 	memset(ptr, 0, size);
 	return ptr;
 }
@@ -65,16 +70,14 @@ EXPORT_SYMBOL(xzalloc);
 
 char *xstrdup(const char *s)
 {
-	char *p;
+	size_t len;
 
 	if (!s)
 		return NULL;
 
-	p = strdup(s);
-	if (!p)
-		enomem_panic(strlen(s) + 1);
+	len = strlen(s) + 1;
 
-	return p;
+	return memcpy(__xmalloc(len, _RET_IP_), s, len);
 }
 EXPORT_SYMBOL(xstrdup);
 
@@ -93,7 +96,7 @@ char *xstrndup(const char *s, size_t n)
 		t++;
 	}
 	n -= m;
-	t = xmalloc(n + 1);
+	t = __xmalloc(n + 1, _RET_IP_);
 	t[n] = '\0';
 
 	return memcpy(t, s, n);
@@ -112,7 +115,7 @@ EXPORT_SYMBOL(xmemalign);
 
 void *xmemdup(const void *orig, size_t size)
 {
-	void *buf = xmalloc(size);
+	void *buf = __xmalloc(size, _RET_IP_);
 
 	memcpy(buf, orig, size);
 
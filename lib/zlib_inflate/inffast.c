@@ -8,46 +8,49 @@
 #include "inflate.h"
 #include "inffast.h"
 
-#ifndef ASMINF
-
-/* Allow machine dependent optimization for post-increment or pre-increment.
-   Based on testing to date,
-   Pre-increment preferred for:
-   - PowerPC G3 (Adler)
-   - MIPS R5000 (Randers-Pehrson)
-   Post-increment preferred for:
-   - none
-   No measurable difference:
-   - Pentium III (Anderson)
-   - M68060 (Nikl)
- */
-union uu {
-	unsigned short us;
-	unsigned char b[2];
-};
+#include <asm/unaligned.h>
 
-/* Endian independed version */
-static inline unsigned short
-get_unaligned16(const unsigned short *p)
-{
-	union uu  mm;
-	unsigned char *b = (unsigned char *)p;
+#ifndef ASMINF
 
-	mm.b[0] = b[0];
-	mm.b[1] = b[1];
-	return mm.us;
-}
+/*
+   The bit buffer is refilled a whole word at a time where that is cheap. On
+   64-bit a branchless refill reads 8 bytes and keeps 56 to 63 bits in hold,
+   enough for two literals plus a length/distance pair without ever checking
+   for more input in between. Bits in hold above "bits" may contain the
+   following input bits, which is harmless as they are or'ed in again with
+   the same value on the next refill and masked off when returning.
 
-#ifdef POSTINC
-#  define OFF 0
-#  define PUP(a) *(a)++
-#  define UP_UNALIGNED(a) get_unaligned16((a)++)
+   32-bit architectures pull single bytes like classic zlib does.
+ */
+#if BITS_PER_LONG == 64
+#  define REFILL() \
+    do { \
+        hold |= (unsigned long)get_unaligned_le64(in) << bits; \
+        in += (63 - bits) >> 3; \
+        bits |= 56; \
+    } while (0)
 #else
-#  define OFF 1
-#  define PUP(a) *++(a)
-#  define UP_UNALIGNED(a) get_unaligned16(++(a))
+#  define REFILL() \
+    do { \
+        while (bits <= BITS_PER_LONG - 8) { \
+            hold += (unsigned long)(*in++) << bits; \
+            bits += 8; \
+        } \
+    } while (0)
 #endif
 
+#define PULLBYTE() \
+    do { \
+        hold += (unsigned long)(*in++) << bits; \
+        bits += 8; \
+    } while (0)
+
+#define CONSUME(n) \
+    do { \
+        hold >>= (n); \
+        bits -= (n); \
+    } while (0)
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -59,8 +62,8 @@ get_unaligned16(const unsigned short *p)
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
-        strm->avail_out >= 258
+        strm->avail_in >= INFLATE_FAST_MIN_IN
+        strm->avail_out >= INFLATE_FAST_MIN_OUT
         start >= strm->avail_out
         state->bits < 8
 
@@ -72,16 +75,15 @@ get_unaligned16(const unsigned short *p)
 
    Notes:
 
-    - The maximum input bits used by a length/distance pair is 15 bits for the
-      length code, 5 bits for the length extra, 15 bits for the distance code,
-      and 13 bits for the distance extra.  This totals 48 bits, or six bytes.
-      Therefore if strm->avail_in >= 6, then there is enough input to avoid
-      checking for available input while decoding.
+    - One loop iteration refills the bit buffer at most twice, reading at
+      most a word each time, and pulls at most two more bytes for distance
+      extra bits on 32-bit. INFLATE_FAST_MIN_IN covers that, so no input
+      checks are needed inside an iteration.
 
-    - The maximum bytes that a single length/distance pair can output is 258
-      bytes, which is the maximum length that can be coded.  inflate_fast()
-      requires strm->avail_out >= 258 for each loop to avoid checking for
-      output space.
+    - One loop iteration writes at most two literals and a match of up to
+      258 bytes. Matches are copied a word at a time and may write up to a
+      word beyond their end, which is overwritten later. INFLATE_FAST_MIN_OUT
+      covers that.
 
     - @start:	inflate()'s starting value for strm->avail_out
  */
@@ -115,11 +117,11 @@ void inflate_fast(z_streamp strm, unsigned start)
 
     /* copy state to local variables */
     state = (struct inflate_state *)strm->state;
-    in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
-    out = strm->next_out - OFF;
+    in = strm->next_in;
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
+    out = strm->next_out;
     beg = out - (start - strm->avail_out);
-    end = out + (strm->avail_out - 257);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUT - 1));
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -137,55 +139,52 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
-        if (bits < 15) {
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-        }
+        REFILL();
         this = lcode[hold & lmask];
+#if BITS_PER_LONG == 64
+        /*
+         * First level literals take at most 9 bits, so two of them can be
+         * written before the regular path, which still finds enough bits
+         * for a literal or a length code with its extra bits.
+         */
+        if (this.op == 0) {
+            CONSUME(this.bits);
+            *out++ = (unsigned char)(this.val);
+            this = lcode[hold & lmask];
+            if (this.op == 0) {
+                CONSUME(this.bits);
+                *out++ = (unsigned char)(this.val);
+                this = lcode[hold & lmask];
+            }
+        }
+#endif
       dolen:
         op = (unsigned)(this.bits);
-        hold >>= op;
-        bits -= op;
+        CONSUME(op);
         op = (unsigned)(this.op);
         if (op == 0) {                          /* literal */
-            PUP(out) = (unsigned char)(this.val);
+            *out++ = (unsigned char)(this.val);
         }
         else if (op & 16) {                     /* length base */
             len = (unsigned)(this.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                }
                 len += (unsigned)hold & ((1U << op) - 1);
-                hold >>= op;
-                bits -= op;
-            }
-            if (bits < 15) {
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
+                CONSUME(op);
             }
+            REFILL();
             this = dcode[hold & dmask];
           dodist:
             op = (unsigned)(this.bits);
-            hold >>= op;
-            bits -= op;
+            CONSUME(op);
             op = (unsigned)(this.op);
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(this.val);
                 op &= 15;                       /* number of extra bits */
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                    if (bits < op) {
-                        hold += (unsigned long)(PUP(in)) << bits;
-                        bits += 8;
-                    }
+                if (BITS_PER_LONG < 64 && bits < op) {
+                    PULLBYTE();
+                    if (bits < op)
+                        PULLBYTE();
                 }
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
@@ -195,8 +194,7 @@ void inflate_fast(z_streamp strm, unsigned start)
                     break;
                 }
 #endif
-                hold >>= op;
-                bits -= op;
+                CONSUME(op);
                 op = (unsigned)(out - beg);     /* max distance in output */
                 if (dist > op) {                /* see if copy from window */
                     op = dist - op;             /* distance back in window */
@@ -205,13 +203,13 @@ void inflate_fast(z_streamp strm, unsigned start)
                         state->mode = BAD;
                         break;
                     }
-                    from = window - OFF;
+                    from = window;
                     if (write == 0) {           /* very common case */
                         from += wsize - op;
                         if (op < len) {         /* some from window */
                             len -= op;
                             do {
-                                PUP(out) = PUP(from);
+                                *out++ = *from++;
                             } while (--op);
                             from = out - dist;  /* rest from output */
                         }
@@ -222,14 +220,14 @@ void inflate_fast(z_streamp strm, unsigned start)
                         if (op < len) {         /* some from end of window */
                             len -= op;
                             do {
-                                PUP(out) = PUP(from);
+                                *out++ = *from++;
                             } while (--op);
-                            from = window - OFF;
+                            from = window;
                             if (write < len) {  /* some from start of window */
                                 op = write;
                                 len -= op;
                                 do {
-                                    PUP(out) = PUP(from);
+                                    *out++ = *from++;
                                 } while (--op);
                                 from = out - dist;      /* rest from output */
                             }
@@ -240,68 +238,45 @@ void inflate_fast(z_streamp strm, unsigned start)
                         if (op < len) {         /* some from window */
                             len -= op;
                             do {
-                                PUP(out) = PUP(from);
+                                *out++ = *from++;
                             } while (--op);
                             from = out - dist;  /* rest from output */
                         }
                     }
                     while (len > 2) {
-                        PUP(out) = PUP(from);
-                        PUP(out) = PUP(from);
-                        PUP(out) = PUP(from);
+                        *out++ = *from++;
+                        *out++ = *from++;
+                        *out++ = *from++;
                         len -= 3;
                     }
                     if (len) {
-                        PUP(out) = PUP(from);
+                        *out++ = *from++;
                         if (len > 1)
-                            PUP(out) = PUP(from);
+                            *out++ = *from++;
                     }
                 }
                 else {
-		    unsigned short *sout;
-		    unsigned long loops;
+                    unsigned char *stop = out + len;
 
                     from = out - dist;          /* copy direct from output */
-		    /* minimum length is three */
-		    /* Align out addr */
-		    if (!((long)(out - 1 + OFF) & 1)) {
-			PUP(out) = PUP(from);
-			len--;
-		    }
-		    sout = (unsigned short *)(out - OFF);
-		    if (dist > 2) {
-			unsigned short *sfrom;
-
-			sfrom = (unsigned short *)(from - OFF);
-			loops = len >> 1;
-			do
-#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
-			    PUP(sout) = PUP(sfrom);
-#else
-			    PUP(sout) = UP_UNALIGNED(sfrom);
-#endif
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-			from = (unsigned char *)sfrom + OFF;
-		    } else { /* dist == 1 or dist == 2 */
-			unsigned short pat16;
-
-			pat16 = *(sout-1+OFF);
-			if (dist == 1) {
-				union uu mm;
-				/* copy one char pattern to both bytes */
-				mm.us = pat16;
-				mm.b[0] = mm.b[1];
-				pat16 = mm.us;
-			}
-			loops = len >> 1;
-			do
-			    PUP(sout) = pat16;
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-		    }
-		    if (len & 1)
-			PUP(out) = PUP(from);
+                    if (dist >= sizeof(unsigned long)) {
+                        /* no overlap within a word, may overshoot stop */
+                        do {
+                            put_unaligned(get_unaligned((unsigned long *)from),
+                                          (unsigned long *)out);
+                            from += sizeof(unsigned long);
+                            out += sizeof(unsigned long);
+                        } while (out < stop);
+                    }
+                    else if (dist == 1) {       /* run of a single byte */
+                        memset(out, *from, len);
+                    }
+                    else {                      /* minimum length is three */
+                        do {
+                            *out++ = *from++;
+                        } while (out < stop);
+                    }
+                    out = stop;
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -333,25 +308,32 @@ void inflate_fast(z_streamp strm, unsigned start)
     len = bits >> 3;
     in -= len;
     bits -= len << 3;
-    hold &= (1U << bits) - 1;
+    hold &= (1UL << bits) - 1;
 
     /* update state and return */
-    strm->next_in = in + OFF;
-    strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->next_in = in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(in < last ?
+            (INFLATE_FAST_MIN_IN - 1) + (last - in) :
+            (INFLATE_FAST_MIN_IN - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
-                                 257 + (end - out) : 257 - (out - end));
+            (INFLATE_FAST_MIN_OUT - 1) + (end - out) :
+            (INFLATE_FAST_MIN_OUT - 1) - (out - end));
     state->hold = hold;
     state->bits = bits;
     return;
 }
 
+/* inflate.c has its own versions, the PBL includes both in one file */
+#undef REFILL
+#undef PULLBYTE
+#undef CONSUME
+
 /*
    inflate_fast() speedups that turned out slower (on a PowerPC G3 750CXe):
    - Using bit fields for code structure
    - Different op definition to avoid & for extra bits (do & for table bits)
    - Three separate decoding do-loops for direct, window, and write == 0
-   - Special case for distance > 1 copies to do overlapped load and store copy
    - Explicit branch predictions (based on measured branch probabilities)
    - Deferring match copy and interspersed it with decoding subsequent codes
    - Swapping literal/length else
@@ -8,4 +8,8 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/* input and output inflate_fast() needs to run without further checks */
+#define INFLATE_FAST_MIN_IN	(2 * sizeof(unsigned long) + 2)
+#define INFLATE_FAST_MIN_OUT	(258 + 2 + sizeof(unsigned long))
+
 void inflate_fast (z_streamp strm, unsigned start);
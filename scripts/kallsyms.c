@@ -147,6 +147,7 @@ static int symbol_valid(struct sym_entry *s)
 		"kallsyms_markers",
 		"kallsyms_token_table",
 		"kallsyms_token_index",
+		"kallsyms_seqs_of_names",
 
 	/* Exclude linker generated symbols which vary between passes */
 		"_SDA_BASE_",		/* ppc */
@@ -245,6 +246,62 @@ static int expand_symbol(unsigned char *data, int len, char *result)
 	return total;
 }
 
+struct sym_name {
+	unsigned int seq;
+	char *name;
+};
+
+static int compare_names(const void *a, const void *b)
+{
+	const struct sym_name *sa = a, *sb = b;
+	int ret;
+
+	ret = strcmp(sa->name, sb->name);
+	if (ret)
+		return ret;
+
+	/* keep the address order of equally named symbols */
+	return sa->seq < sb->seq ? -1 : sa->seq > sb->seq;
+}
+
+/* indices of all symbols sorted by name, for kallsyms_lookup_name() */
+static void write_seqs_of_names(void)
+{
+	struct sym_name *names;
+	char buf[KSYM_NAME_LEN];
+	unsigned int i;
+
+	names = malloc(sizeof(*names) * table_cnt);
+	if (!names) {
+		fprintf(stderr, "kallsyms failure: "
+			"unable to allocate required memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < table_cnt; i++) {
+		expand_symbol(table[i].sym, table[i].len, buf);
+		names[i].seq = i;
+		/* skip the type character */
+		names[i].name = strdup(buf + 1);
+		if (!names[i].name) {
+			fprintf(stderr, "kallsyms failure: "
+				"unable to allocate required memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	qsort(names, table_cnt, sizeof(*names), compare_names);
+
+	output_label("kallsyms_seqs_of_names");
+	for (i = 0; i < table_cnt; i++) {
+		printf("\t.long\t%u\n", names[i].seq);
+		free(names[i].name);
+	}
+	printf("\n");
+
+	free(names);
+}
+
 static void write_src(void)
 {
 	unsigned int i, k, off;
@@ -334,6 +391,8 @@ static void write_src(void)
 	for (i = 0; i < 256; i++)
 		printf("\t.short\t%u\n", best_idx[i]);
 	printf("\n");
+
+	write_seqs_of_names();
 }
 
 
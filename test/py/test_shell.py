@@ -34,3 +34,20 @@ def test_barebox_no_err(barebox, barebox_config):
     # TODO extend by err once all qemu platforms conform
     stdout, _, _ = barebox.run('dmesg -l crit,alert,emerg')
     assert stdout == []
+
+def test_barebox_script_cache(barebox, barebox_config):
+    skip_disabled(barebox_config, "CONFIG_CMD_ECHO")
+
+    barebox.run_check("echo -o cachetest 'for i in a b; do echo $i-$1; done'")
+
+    # second run comes from the script cache if enabled
+    for _ in range(2):
+        out = barebox.run_check("sh cachetest x")
+        assert out == ["a-x", "b-x"]
+
+    out = barebox.run_check("sh cachetest y")
+    assert out == ["a-y", "b-y"]
+
+    barebox.run_check("echo -o cachetest 'echo changed'")
+    out = barebox.run_check("sh cachetest")
+    assert out == ["changed"]
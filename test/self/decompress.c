@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Decompress the same payload with every enabled codec, check the result
+ * and report the throughput. Running this on sandbox gives comparable
+ * numbers for the decompressors without needing any target hardware.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <clock.h>
+#include <malloc.h>
+#include <uncompress.h>
+#include <linux/math64.h>
+
+BSELFTEST_GLOBALS();
+
+#define DECLARE_PAYLOAD(sym) \
+	extern const u8 sym[], sym##_end[]
+
+DECLARE_PAYLOAD(decompress_payload);
+DECLARE_PAYLOAD(decompress_payload_gzip);
+DECLARE_PAYLOAD(decompress_payload_lz4);
+DECLARE_PAYLOAD(decompress_payload_lzo);
+DECLARE_PAYLOAD(decompress_payload_xzkern);
+DECLARE_PAYLOAD(decompress_payload_zstd19);
+
+/* decompress each payload for at least this long to get stable numbers */
+#define DECOMPRESS_BENCH_NS	(200 * MSECOND)
+
+static void test_decompress_one(const char *name, const u8 *start,
+				const u8 *end)
+{
+	size_t len = decompress_payload_end - decompress_payload;
+	unsigned int loops = 0;
+	u64 t0, ns;
+	u8 *buf;
+	int ret;
+
+	total_tests++;
+
+	buf = malloc(len);
+	if (!buf) {
+		failed_tests++;
+		return;
+	}
+
+	t0 = get_time_ns();
+
+	do {
+		memset(buf, 0, len);
+
+		ret = uncompress((void *)start, end - start, NULL, NULL, buf,
+				 NULL, uncompress_err_stdout);
+		if (ret) {
+			failed_tests++;
+			pr_err("%s: decompression failed: %d\n", name, ret);
+			goto out;
+		}
+
+		loops++;
+		ns = get_time_ns() - t0;
+	} while (ns < DECOMPRESS_BENCH_NS);
+
+	if (memcmp(buf, decompress_payload, len)) {
+		failed_tests++;
+		pr_err("%s: decompressed data differs\n", name);
+		goto out;
+	}
+
+	pr_info("%-6s %7zu -> %7zu bytes: %5llu MB/s\n", name,
+		(size_t)(end - start), len,
+		div64_u64((u64)len * loops * 1000, ns ?: 1));
+out:
+	free(buf);
+}
+
+#define test_decompress(cond, fmt) do { \
+	if (IS_ENABLED(cond)) \
+		test_decompress_one(#fmt, decompress_payload_##fmt, \
+				    decompress_payload_##fmt##_end); \
+} while (0)
+
+static void test_decompress_all(void)
+{
+	test_decompress(CONFIG_ZLIB, gzip);
+	test_decompress(CONFIG_LZ4_DECOMPRESS, lz4);
+	test_decompress(CONFIG_LZO_DECOMPRESS, lzo);
+	test_decompress(CONFIG_XZ_DECOMPRESS, xzkern);
+	test_decompress(CONFIG_ZSTD_DECOMPRESS, zstd19);
+}
+bselftest(core, test_decompress_all);
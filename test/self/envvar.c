@@ -80,3 +80,65 @@ static void test_envvar(void)
 	unsetenv("__TEST_VAR1");
 }
 bselftest(core, test_envvar);
+
+#define ENVVAR_MANY	300
+
+static void test_envvar_many(void)
+{
+	struct env_context *c;
+	struct variable_d *v;
+	char name[32], val[32];
+	int i, n;
+
+	if (!IS_ENABLED(CONFIG_ENVIRONMENT_VARIABLES))
+		return;
+
+	env_push_context();
+	c = get_current_context();
+
+	for (i = 0; i < ENVVAR_MANY; i++) {
+		sprintf(name, "__TEST_MANY%d", i);
+		sprintf(val, "%d", i);
+		setenv(name, val);
+	}
+
+	/* shadow a variable of the parent context */
+	setenv("__TEST_MANY0", "global");
+	export("__TEST_MANY0");
+	env_push_context();
+	setenv("__TEST_MANY0", "local");
+	expect_getenv("__TEST_MANY0", "local");
+	unsetenv("__TEST_MANY0");
+	expect_getenv("__TEST_MANY0", "global");
+	env_pop_context();
+
+	for (i = 1; i < ENVVAR_MANY; i += 2) {
+		sprintf(name, "__TEST_MANY%d", i);
+		unsetenv(name);
+	}
+
+	for (i = 1; i < ENVVAR_MANY; i++) {
+		sprintf(name, "__TEST_MANY%d", i);
+		sprintf(val, "%d", i);
+		expect_getenv(name, i & 1 ? NULL : val);
+	}
+
+	/* the listing keeps the insertion order */
+	n = 2;
+	total_tests++;
+	list_for_each_entry(v, &c->local, list) {
+		sprintf(name, "__TEST_MANY%d", n);
+		if (strcmp(var_name(v), name)) {
+			failed_tests++;
+			printf("%s: found %s, but %s expected\n", __func__,
+			       var_name(v), name);
+			break;
+		}
+		n += 2;
+	}
+
+	env_pop_context();
+
+	expect_getenv("__TEST_MANY2", NULL);
+}
+bselftest(core, test_envvar_many);
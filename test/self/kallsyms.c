@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <kallsyms.h>
+
+BSELFTEST_GLOBALS();
+
+#define __expect(cond, fmt, ...) ({ \
+	bool __cond = (cond); \
+	total_tests++; \
+	\
+	if (!__cond) { \
+		failed_tests++; \
+		printf("%s failed at %s:%d " fmt "\n", \
+			#cond, __func__, __LINE__, ##__VA_ARGS__); \
+	} \
+	__cond; \
+})
+
+#define expect(ret, ...) __expect((ret), __VA_ARGS__)
+
+/* kallsyms has no Thumb bit in its addresses */
+#define func_addr(fn)	((unsigned long)(fn) & ~1UL)
+
+static void test_kallsyms_func(const char *name, unsigned long addr)
+{
+	char buf[KSYM_SYMBOL_LEN];
+	unsigned long size, offset;
+	const char *sym;
+
+	expect(kallsyms_lookup_name(name) == addr, "for %s", name);
+
+	sym = kallsyms_lookup(addr, &size, &offset, NULL, buf);
+	if (!expect(sym != NULL, "for %s", name))
+		return;
+
+	expect(!strcmp(sym, name), "%s != %s", sym, name);
+	expect(offset == 0, "for %s", name);
+	expect(size > 0, "for %s", name);
+
+	sym = kallsyms_lookup(addr + size - 1, NULL, &offset, NULL, buf);
+	expect(sym && !strcmp(sym, name), "for end of %s", name);
+	expect(offset == size - 1, "for end of %s", name);
+}
+
+static void test_kallsyms(void)
+{
+	char buf[KSYM_SYMBOL_LEN];
+
+	test_kallsyms_func("kallsyms_lookup_name", func_addr(kallsyms_lookup_name));
+	test_kallsyms_func("kallsyms_lookup", func_addr(kallsyms_lookup));
+	test_kallsyms_func("sprint_symbol", func_addr(sprint_symbol));
+	test_kallsyms_func("printf", func_addr(printf));
+
+	expect(kallsyms_lookup_name("") == 0);
+	expect(kallsyms_lookup_name("this_symbol_does_not_exist") == 0);
+	expect(kallsyms_lookup_name("~") == 0);
+
+	sprint_symbol(buf, func_addr(printf) + 4);
+	expect(!strncmp(buf, "printf+0x4/", 11), "got %s", buf);
+}
+bselftest(core, test_kallsyms);
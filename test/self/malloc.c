@@ -4,6 +4,8 @@
 
 #include <common.h>
 #include <bselftest.h>
+#include <arena.h>
+#include <clock.h>
 #include <malloc.h>
 #include <memory.h>
 #include <linux/sizes.h>
@@ -133,3 +135,94 @@ static void test_malloc(void)
 	free(tmp);
 }
 bselftest(core, test_malloc);
+
+static void test_arena(void)
+{
+	struct arena arena;
+	char *str, *big;
+	u64 *p;
+	int i;
+
+	arena_init(&arena, SZ_1K);
+
+	for (i = 0; i < 100; i++) {
+		p = expect_alloc_ok(arena_alloc(&arena, 3 * i + 1));
+		if (!p)
+			break;
+
+		__expect_cond(IS_ALIGNED((uintptr_t)p, sizeof(u64)), true,
+			      "arena alignment", __func__, __LINE__);
+		*p = i;
+	}
+
+	str = arena_strdup(&arena, "barebox");
+	__expect_cond(str && !strcmp(str, "barebox"), true,
+		      "arena_strdup", __func__, __LINE__);
+
+	big = expect_alloc_ok(arena_zalloc(&arena, SZ_4K));
+	__expect_cond(big && !big[0] && !big[SZ_4K - 1], true,
+		      "arena_zalloc", __func__, __LINE__);
+
+	__expect_cond(arena_contains(&arena, str), true,
+		      "arena_contains(str)", __func__, __LINE__);
+	__expect_cond(arena_contains(&arena, big + SZ_4K - 1), true,
+		      "arena_contains(big)", __func__, __LINE__);
+	__expect_cond(arena_contains(&arena, &arena), false,
+		      "arena_contains(&arena)", __func__, __LINE__);
+
+	arena_free(&arena);
+
+	__expect_cond(arena_size(&arena) == 0, true,
+		      "arena_free", __func__, __LINE__);
+}
+bselftest(core, test_arena);
+
+#define MALLOC_BENCH_OBJS	1024
+#define MALLOC_BENCH_ROUNDS	16
+
+/*
+ * Allocate and free objects of the sizes that dominate barebox heap
+ * usage, in the interleaved pattern of e.g. device tree unflattening
+ */
+static void test_malloc_bench(void)
+{
+	static const size_t sizes[] = { 8, 24, 40, 64, 100, 200, 500, 1500 };
+	void **objs;
+	u64 start, ns;
+	int i, j, n;
+
+	objs = malloc(MALLOC_BENCH_OBJS * sizeof(*objs));
+	if (!expect_alloc_ok(objs))
+		return;
+
+	start = get_time_ns();
+
+	for (i = 0; i < MALLOC_BENCH_ROUNDS; i++) {
+		for (n = 0; n < MALLOC_BENCH_OBJS; n++) {
+			objs[n] = malloc(sizes[(i + n) % ARRAY_SIZE(sizes)]);
+			if (!objs[n])
+				break;
+		}
+
+		__expect_cond(n == MALLOC_BENCH_OBJS, true,
+			      "benchmark allocation", __func__, __LINE__);
+
+		/* free every other object first to fragment the heap */
+		for (j = 0; j < n; j += 2)
+			free(objs[j]);
+		for (j = 1; j < n; j += 2)
+			free(objs[j]);
+
+		if (n != MALLOC_BENCH_OBJS)
+			break;
+	}
+
+	ns = get_time_ns() - start;
+
+	pr_info("%u malloc/free pairs in %llu us, %llu ns each\n",
+		MALLOC_BENCH_OBJS * MALLOC_BENCH_ROUNDS, ns / 1000,
+		ns / (MALLOC_BENCH_OBJS * MALLOC_BENCH_ROUNDS));
+
+	free(objs);
+}
+bselftest(core, test_malloc_bench);
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <memtest.h>
+#include <linux/sizes.h>
+#include <linux/time.h>
+
+BSELFTEST_GLOBALS();
+
+static void expect_rate(u64 bytes, u64 ns, u64 expected)
+{
+	u64 rate = mem_test_rate(bytes, ns);
+
+	total_tests++;
+
+	if (rate != expected) {
+		failed_tests++;
+		printf("%llu bytes in %llu ns: got %llu.%02llu MiB/s, expected %llu.%02llu MiB/s\n",
+		       bytes, ns, rate / 100, rate % 100,
+		       expected / 100, expected % 100);
+	}
+}
+
+static void test_memtest_rate(void)
+{
+	expect_rate(SZ_1M, NSEC_PER_SEC, 100);
+	expect_rate(3 * SZ_1K, NSEC_PER_MSEC, 292);
+	expect_rate(SZ_1G, NSEC_PER_SEC / 4, 409600);
+
+	/* three sweeps over 3 GiB and 64 GiB of DRAM */
+	expect_rate(3 * 3ULL * SZ_1G, NSEC_PER_SEC, 921600);
+	expect_rate(3 * 64ULL * SZ_1G, 2ULL * NSEC_PER_SEC, 9830400);
+
+	/* no division by zero for a too short test */
+	expect_rate(SZ_1K, 0, 97656250);
+}
+bselftest(core, test_memtest_rate);
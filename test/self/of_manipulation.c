@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <linux/string.h>
 #include <errno.h>
+#include <clock.h>
+#include <malloc.h>
 #include <of.h>
 
 BSELFTEST_GLOBALS();
@@ -110,6 +112,255 @@ static void test_of_property_strings(struct device_node *root)
 	assert_equal(np3, np4);
 }
 
+static void assert_phandle(phandle p, struct device_node *root,
+			   struct device_node *expect)
+{
+	struct device_node *np;
+
+	total_tests++;
+
+	np = of_find_node_by_phandle_from(p, root);
+	if (np == expect)
+		return;
+
+	pr_warn("phandle 0x%x: expected %pOF, found %pOF\n", p, expect, np);
+	failed_tests++;
+}
+
+static void test_of_phandle_lookup(struct device_node *root)
+{
+	struct device_node *np1, *np2;
+	phandle p1, p2;
+
+	np1 = of_new_node(root, "phandle1");
+	np2 = of_new_node(root, "phandle2");
+
+	p1 = of_node_create_phandle(np1);
+	p2 = of_node_create_phandle(np2);
+
+	/* repeated lookups may be served from the phandle cache */
+	assert_phandle(p1, root, np1);
+	assert_phandle(p1, root, np1);
+	assert_phandle(p2, root, np2);
+
+	of_delete_node(np1);
+
+	assert_phandle(p1, root, NULL);
+	assert_phandle(p2, root, np2);
+
+	of_delete_node(np2);
+
+	assert_phandle(p2, root, NULL);
+}
+
+/*
+ * Flatten @tree, unflatten the result and flatten it again. Both dtbs
+ * must be identical. Also modify the unflattened copy, as its nodes and
+ * properties come from an arena and must survive being freed one by one.
+ */
+static void test_of_flatten_roundtrip(struct device_node *tree, const char *what)
+{
+	struct fdt_header *fdt1, *fdt2 = NULL;
+	struct device_node *copy, *np;
+	u64 t_flatten, t_unflatten;
+	u32 size;
+
+	total_tests++;
+
+	t_flatten = get_time_ns();
+	fdt1 = of_flatten_dtb(tree);
+	t_flatten = get_time_ns() - t_flatten;
+	if (!fdt1) {
+		pr_warn("%s: flattening failed\n", what);
+		failed_tests++;
+		return;
+	}
+
+	size = be32_to_cpu(fdt1->totalsize);
+
+	t_unflatten = get_time_ns();
+	copy = of_unflatten_dtb(fdt1, size);
+	t_unflatten = get_time_ns() - t_unflatten;
+	if (IS_ERR(copy)) {
+		pr_warn("%s: unflattening failed: %pe\n", what, copy);
+		failed_tests++;
+		goto out;
+	}
+
+	fdt2 = of_flatten_dtb(copy);
+	if (!fdt2 || be32_to_cpu(fdt2->totalsize) != size ||
+	    memcmp(fdt1, fdt2, size)) {
+		pr_warn("%s: dtb differs after unflatten/flatten round trip\n", what);
+		failed_tests++;
+	}
+
+	pr_info("%s: %u bytes, flatten %llu us, unflatten %llu us\n", what, size,
+		t_flatten / 1000, t_unflatten / 1000);
+
+	np = of_new_node(copy, "heap-node");
+	of_property_write_u32(np, "heap-property", 1);
+
+	for_each_child_of_node(copy, np) {
+		struct property *pp;
+
+		of_property_write_bool(np, "roundtrip-bool", true);
+		of_append_property(np, "roundtrip-bool", "a", 2);
+
+		pp = list_first_entry_or_null(&np->properties, struct property, list);
+		if (pp && strcmp(pp->name, "roundtrip-bool"))
+			of_rename_property(np, pp->name, "roundtrip-renamed");
+	}
+
+	np = list_first_entry_or_null(&copy->children, struct device_node, parent_list);
+	of_delete_node(np);
+
+	of_delete_node(copy);
+out:
+	free(fdt1);
+	free(fdt2);
+}
+
+static struct device_node *find_compatible_walk(struct device_node *from,
+						const char *compatible)
+{
+	struct device_node *np = from;
+
+	/* doesn't use the compatible index */
+	while ((np = of_find_node_with_property(np, "compatible")))
+		if (of_device_is_compatible(np, compatible))
+			return np;
+
+	return NULL;
+}
+
+/*
+ * Check that iterating over all nodes compatible to @compatible gives the
+ * same nodes in the same order as walking the tree, starting with @first
+ */
+static void assert_compatible(const char *compatible, struct device_node *first)
+{
+	struct device_node *np, *walk;
+
+	np = of_find_compatible_node(NULL, NULL, compatible);
+	walk = find_compatible_walk(NULL, compatible);
+
+	total_tests++;
+	if (np != first || walk != first) {
+		pr_warn("%s: expected %pOF first, found %pOF (walk: %pOF)\n",
+			compatible, first, np, walk);
+		failed_tests++;
+		return;
+	}
+
+	while (np) {
+		np = of_find_compatible_node(np, NULL, compatible);
+		walk = find_compatible_walk(walk, compatible);
+
+		total_tests++;
+		if (np != walk) {
+			pr_warn("%s: found %pOF, walk found %pOF\n",
+				compatible, np, walk);
+			failed_tests++;
+			return;
+		}
+	}
+}
+
+static void assert_compatible_from(struct device_node *from,
+				   const char *compatible)
+{
+	struct device_node *np, *walk;
+
+	total_tests++;
+
+	np = of_find_compatible_node(from, NULL, compatible);
+	walk = find_compatible_walk(from, compatible);
+	if (np == walk)
+		return;
+
+	pr_warn("%s from %pOF: found %pOF, walk found %pOF\n",
+		compatible, from, np, walk);
+	failed_tests++;
+}
+
+static void set_compatible(struct device_node *np, const char *compatible,
+			   int len)
+{
+	total_tests++;
+
+	if (of_set_property(np, "compatible", compatible, len, 1)) {
+		pr_warn("cannot set compatible of %pOF\n", np);
+		failed_tests++;
+	}
+}
+
+#define TEST_COMPAT_A	"barebox,selftest-compat-a"
+#define TEST_COMPAT_B	"barebox,selftest-compat-b"
+#define TEST_COMPAT_C	"barebox,selftest-compat-c"
+
+/* The compatible index is only used for the live tree */
+static void test_of_compat_index(void)
+{
+	struct device_node *live = of_get_root_node();
+	struct device_node *base, *n1, *n2, *n3, *n4;
+	const char *first;
+
+	if (!live)
+		return;
+
+	base = of_new_node(live, "selftest-compat-index");
+	n1 = of_new_node(base, "n1");
+	n2 = of_new_node(base, "n2");
+
+	/* multiple compatibles per node */
+	set_compatible(n1, TEST_COMPAT_A "\0" TEST_COMPAT_B,
+		       sizeof(TEST_COMPAT_A "\0" TEST_COMPAT_B));
+	set_compatible(n2, TEST_COMPAT_B, sizeof(TEST_COMPAT_B));
+
+	/* builds the index */
+	assert_compatible(TEST_COMPAT_A, n1);
+	assert_compatible(TEST_COMPAT_B, n1);
+	assert_compatible(TEST_COMPAT_C, NULL);
+
+	/* ordering of nodes already in the live tree */
+	first = of_get_property(live, "compatible", NULL);
+	if (first)
+		assert_compatible(first, live);
+
+	/* nodes added after the index was built */
+	n3 = of_new_node(base, "n3");
+	set_compatible(n3, TEST_COMPAT_A, sizeof(TEST_COMPAT_A));
+	n4 = of_new_node(base, "n4");
+
+	assert_compatible(TEST_COMPAT_A, n1);
+	assert_compatible_from(n3, TEST_COMPAT_A);
+	assert_compatible_from(n4, TEST_COMPAT_A);
+	assert_compatible_from(n2, TEST_COMPAT_A);
+
+	/* changed and removed compatibles */
+	set_compatible(n1, TEST_COMPAT_C, sizeof(TEST_COMPAT_C));
+	assert_compatible(TEST_COMPAT_A, n3);
+	assert_compatible(TEST_COMPAT_B, n2);
+	assert_compatible(TEST_COMPAT_C, n1);
+
+	set_compatible(n2, NULL, 0);
+	assert_compatible(TEST_COMPAT_B, NULL);
+
+	of_delete_property(of_find_property(n1, "compatible", NULL));
+	assert_compatible(TEST_COMPAT_C, NULL);
+
+	/* node deletion */
+	of_delete_node(n3);
+	assert_compatible(TEST_COMPAT_A, NULL);
+	assert_compatible_from(n2, TEST_COMPAT_A);
+
+	set_compatible(n4, TEST_COMPAT_B, sizeof(TEST_COMPAT_B));
+	assert_compatible(TEST_COMPAT_B, n4);
+
+	of_delete_node(base);
+	assert_compatible(TEST_COMPAT_B, NULL);
+}
+
 static void __init test_of_manipulation(void)
 {
 	extern char __dtb_of_manipulation_start[], __dtb_of_manipulation_end[];
@@ -118,6 +369,8 @@ static void __init test_of_manipulation(void)
 
 	test_of_basics(root);
 	test_of_property_strings(root);
+	test_of_phandle_lookup(root);
+	test_of_compat_index();
 
 	expected = of_unflatten_dtb(__dtb_of_manipulation_start,
 				    __dtb_of_manipulation_end - __dtb_of_manipulation_start);
@@ -126,6 +379,10 @@ static void __init test_of_manipulation(void)
 
 	assert_equal(root, expected);
 
+	test_of_flatten_roundtrip(expected, "test tree");
+	if (of_get_root_node())
+		test_of_flatten_roundtrip(of_get_root_node(), "live tree");
+
 	of_delete_node(root);
 	of_delete_node(expected);
 }
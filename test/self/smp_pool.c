@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <malloc.h>
+#include <smp_pool.h>
+#include <linux/sizes.h>
+
+BSELFTEST_GLOBALS();
+
+#define __expect(cond, fmt, ...) ({ \
+	bool __cond = (cond); \
+	total_tests++; \
+	\
+	if (!__cond) { \
+		failed_tests++; \
+		printf("%s failed at %s:%d " fmt "\n", \
+			#cond, __func__, __LINE__, ##__VA_ARGS__); \
+	} \
+	__cond; \
+})
+
+#define expect(ret, ...) __expect((ret), __VA_ARGS__)
+
+#define SMP_POOL_TEST_ITEMS	1000
+
+struct smp_pool_test {
+	unsigned int runs[SMP_POOL_TEST_ITEMS];
+	unsigned int cpu[SMP_POOL_TEST_ITEMS];
+};
+
+static void smp_pool_test_fn(void *data, unsigned int idx, unsigned int cpu)
+{
+	struct smp_pool_test *t = data;
+
+	__atomic_fetch_add(&t->runs[idx], 1, __ATOMIC_RELAXED);
+	t->cpu[idx] = cpu;
+}
+
+static void test_smp_pool_run_once(struct smp_pool_test *t, unsigned int n)
+{
+	unsigned int i, bad_runs = 0, bad_cpu = 0;
+
+	memset(t, 0, sizeof(*t));
+
+	smp_pool_run(smp_pool_test_fn, t, n);
+
+	for (i = 0; i < SMP_POOL_TEST_ITEMS; i++) {
+		if (t->runs[i] != (i < n))
+			bad_runs++;
+		if (t->cpu[i] >= smp_pool_cpus())
+			bad_cpu++;
+	}
+
+	expect(bad_runs == 0, "%u of %u items not run exactly once", bad_runs, n);
+	expect(bad_cpu == 0, "%u items ran on an invalid CPU", bad_cpu);
+}
+
+static void test_smp_pool_run(void)
+{
+	struct smp_pool_test *t;
+
+	t = malloc(sizeof(*t));
+	if (!expect(t != NULL))
+		return;
+
+	test_smp_pool_run_once(t, 0);
+	test_smp_pool_run_once(t, 1);
+	test_smp_pool_run_once(t, SMP_POOL_TEST_ITEMS);
+
+	/* the secondaries stay online until parked */
+	expect(smp_pool_online() == (smp_pool_cpus() > 1));
+
+	expect(smp_pool_park() == 0);
+	expect(!smp_pool_online());
+	expect(smp_pool_park() == 0);
+
+	/* and come back up on the next job */
+	test_smp_pool_run_once(t, SMP_POOL_TEST_ITEMS / 3);
+	expect(smp_pool_park() == 0);
+	expect(!smp_pool_online());
+
+	free(t);
+}
+bselftest(core, test_smp_pool_run);
+
+static void test_smp_pool_mem(void)
+{
+	size_t len = SZ_4M + 123, i, bad = 0;
+	u8 *src, *dst;
+
+	src = malloc(len);
+	dst = malloc(len);
+	if (!expect(src && dst))
+		goto out;
+
+	smp_memset(src, 0x5a, len);
+	for (i = 0; i < len; i++)
+		bad += src[i] != 0x5a;
+	expect(bad == 0, "%zu bytes not set", bad);
+
+	for (i = 0; i < len; i++)
+		src[i] = i * 7;
+
+	smp_memcpy(dst + 1, src, len - 1);
+	bad = 0;
+	for (i = 0; i < len - 1; i++)
+		bad += dst[i + 1] != (u8)(i * 7);
+	expect(bad == 0, "%zu bytes not copied", bad);
+
+	expect(smp_pool_park() == 0);
+out:
+	free(src);
+	free(dst);
+}
+bselftest(core, test_smp_pool_mem);
@@ -4,7 +4,11 @@
 
 #include <common.h>
 #include <bselftest.h>
+#include <clock.h>
+#include <malloc.h>
 #include <string.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 BSELFTEST_GLOBALS();
 
@@ -195,9 +199,236 @@ static void test_strjoin(void)
 	expect_dynstreq(strjoin(" ",   NULL, 0),                "");
 }
 
+/*
+ * The memory functions work a word at a time once the buffers are large
+ * enough, so check all head and tail alignments around a few words.
+ */
+#define MEM_TEST_OFFS	(2 * sizeof(long))
+#define MEM_TEST_LEN	(6 * sizeof(long))
+#define MEM_TEST_SIZE	(2 * MEM_TEST_OFFS + MEM_TEST_LEN + 16)
+
+static u8 mem_pattern(size_t i)
+{
+	return i * 7 + 3;
+}
+
+static void __expect_mem(const char *func, int line, bool ok, const char *what,
+			 size_t len, size_t off1, size_t off2)
+{
+	total_tests++;
+	if (!ok) {
+		failed_tests++;
+		printf("%s:%d: %s failed for len %zu, offsets %zu/%zu\n",
+		       func, line, what, len, off1, off2);
+	}
+}
+
+#define expect_mem(ok, what, len, off1, off2) \
+	__expect_mem(__func__, __LINE__, ok, what, len, off1, off2)
+
+static bool mem_check(const u8 *buf, size_t start, size_t len,
+		      u8 (*expect)(size_t i, const void *ctx), const void *ctx)
+{
+	size_t i;
+
+	for (i = 0; i < MEM_TEST_SIZE; i++) {
+		if (i >= start && i < start + len) {
+			if (buf[i] != expect(i - start, ctx))
+				return false;
+		} else if (buf[i] != 0xaa) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static u8 mem_expect_set(size_t i, const void *ctx)
+{
+	return 0x5c;
+}
+
+static u8 mem_expect_copy(size_t i, const void *ctx)
+{
+	size_t soff = *(const size_t *)ctx;
+
+	return mem_pattern(soff + i);
+}
+
+static void test_mem_one(u8 *dst, u8 *src, size_t len, size_t doff, size_t soff)
+{
+	size_t i, d, s;
+	u8 *p;
+
+	for (i = 0; i < MEM_TEST_SIZE; i++)
+		src[i] = mem_pattern(i);
+
+	memset(dst, 0xaa, MEM_TEST_SIZE);
+	memset(dst + doff, 0x5c, len);
+	expect_mem(mem_check(dst, doff, len, mem_expect_set, NULL),
+		   "memset", len, doff, 0);
+
+	memset(dst, 0xaa, MEM_TEST_SIZE);
+	memcpy(dst + doff, src + soff, len);
+	expect_mem(mem_check(dst, doff, len, mem_expect_copy, &soff),
+		   "memcpy", len, doff, soff);
+
+	/* overlapping in both directions, within src */
+	d = MEM_TEST_OFFS + doff;
+	s = MEM_TEST_OFFS + soff;
+	memmove(src + d, src + s, len);
+	for (i = 0; i < MEM_TEST_SIZE; i++) {
+		u8 expect = i >= d && i < d + len ? mem_pattern(s + i - d) :
+			    mem_pattern(i);
+		if (src[i] != expect)
+			break;
+	}
+	expect_mem(i == MEM_TEST_SIZE, "memmove", len, d, s);
+
+	for (i = 0; i < MEM_TEST_SIZE; i++)
+		src[i] = dst[i] = mem_pattern(i);
+
+	expect_mem(memcmp(dst + soff, src + soff, len) == 0, "memcmp",
+		   len, soff, soff);
+	if (len) {
+		src[soff + len - 1] = 0;
+		dst[soff + len - 1] = 1;
+		expect_mem(memcmp(dst + soff, src + soff, len) > 0, "memcmp",
+			   len, soff, soff);
+		expect_mem(memcmp(src + soff, dst + soff, len) < 0, "memcmp",
+			   len, soff, soff);
+	}
+
+	memset(src, 0xaa, MEM_TEST_SIZE);
+	expect_mem(memchr(src + soff, 0x5c, len) == NULL, "memchr", len, soff, 0);
+	if (len) {
+		src[soff + len - 1] = 0x5c;
+		src[soff + len + 1] = 0x5c;
+		p = memchr(src + soff, 0x5c, len);
+		expect_mem(p == src + soff + len - 1, "memchr", len, soff, 0);
+	}
+
+	src[soff + len] = '\0';
+	expect_mem(strlen((char *)src + soff) == len, "strlen", len, soff, 0);
+}
+
+static void test_mem(void)
+{
+	size_t len, doff, soff;
+	u8 *dst, *src;
+
+	dst = malloc(MEM_TEST_SIZE);
+	src = malloc(MEM_TEST_SIZE);
+	if (!dst || !src) {
+		total_tests++;
+		failed_tests++;
+		goto out;
+	}
+
+	for (len = 0; len <= MEM_TEST_LEN; len++)
+		for (doff = 0; doff < MEM_TEST_OFFS; doff++)
+			for (soff = 0; soff < MEM_TEST_OFFS; soff++)
+				test_mem_one(dst, src, len, doff, soff);
+out:
+	free(dst);
+	free(src);
+}
+
+/* run each function for at least this long to get stable numbers */
+#define MEM_BENCH_NS	(20 * MSECOND)
+
+enum mem_bench_op {
+	MEM_BENCH_MEMCPY,
+	MEM_BENCH_MEMMOVE,
+	MEM_BENCH_MEMSET,
+	MEM_BENCH_MEMCMP,
+	MEM_BENCH_MEMCHR,
+	MEM_BENCH_STRLEN,
+};
+
+static const char * const mem_bench_names[] = {
+	[MEM_BENCH_MEMCPY] = "memcpy",
+	[MEM_BENCH_MEMMOVE] = "memmove",
+	[MEM_BENCH_MEMSET] = "memset",
+	[MEM_BENCH_MEMCMP] = "memcmp",
+	[MEM_BENCH_MEMCHR] = "memchr",
+	[MEM_BENCH_STRLEN] = "strlen",
+};
+
+static void mem_bench_one(enum mem_bench_op op, u8 *dst, u8 *src, size_t len)
+{
+	unsigned int loops = 0;
+	u64 t0, ns;
+
+	memset(src, 'x', len);
+	memset(dst, 'x', len);
+	src[len - 1] = '\0';
+
+	t0 = get_time_ns();
+
+	do {
+		switch (op) {
+		case MEM_BENCH_MEMCPY:
+			memcpy(dst, src, len);
+			break;
+		case MEM_BENCH_MEMMOVE:
+			memmove(dst, dst + 1, len - 1);
+			break;
+		case MEM_BENCH_MEMSET:
+			memset(dst, 'x', len);
+			break;
+		case MEM_BENCH_MEMCMP:
+			if (memcmp(dst, src, len - 1))
+				goto fail;
+			break;
+		case MEM_BENCH_MEMCHR:
+			if (memchr(src, 'y', len))
+				goto fail;
+			break;
+		case MEM_BENCH_STRLEN:
+			if (strlen((char *)src) != len - 1)
+				goto fail;
+			break;
+		}
+
+		loops++;
+		ns = get_time_ns() - t0;
+	} while (ns < MEM_BENCH_NS);
+
+	pr_info("%-7s %7zu bytes: %6llu MB/s\n", mem_bench_names[op], len,
+		div64_u64((u64)len * loops * 1000, ns ?: 1));
+	return;
+fail:
+	total_tests++;
+	failed_tests++;
+	pr_err("%s: wrong result\n", mem_bench_names[op]);
+}
+
+static void test_mem_bench(void)
+{
+	static const size_t sizes[] = { 256, SZ_64K };
+	enum mem_bench_op op;
+	u8 *dst, *src;
+	int i;
+
+	dst = malloc(SZ_64K);
+	src = malloc(SZ_64K);
+	if (!dst || !src)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		for (op = 0; op < ARRAY_SIZE(mem_bench_names); op++)
+			mem_bench_one(op, dst, src, sizes[i]);
+out:
+	free(dst);
+	free(src);
+}
+
 static void test_string(void)
 {
 	test_strverscmp();
 	test_strjoin();
+	test_mem();
+	test_mem_bench();
 }
 bselftest(parser, test_string);